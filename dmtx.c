@@ -78,6 +78,10 @@
 #include "dmtxplacemod.c"
 #include "dmtxreedsol.c"
 #include "dmtxscangrid.c"
+#include "dmtxsample.c"
+#include "dmtxhough.c"
+#include "dmtxrunlength.c"
+#include "dmtxverify.c"
 
 #include "dmtximage.c"
 #include "dmtxbytelist.c"
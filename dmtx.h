@@ -164,6 +164,17 @@ typedef enum {
    DmtxCorner01              = 0x01 << 3
 } DmtxCornerLoc;
 
+typedef enum {
+   DmtxSampleNearest,        /* Module sub-samples read nearest pixel */
+   DmtxSampleBilinear        /* Module sub-samples interpolate 4 pixels */
+} DmtxSampleMode;
+
+typedef enum {
+   DmtxDetectTrail,          /* Trace edges from scan grid locations */
+   DmtxDetectHough,          /* Screen image tiles with local line Hough */
+   DmtxDetectRunLength       /* Group dark row runs into candidate symbols */
+} DmtxDetectMode;
+
 typedef enum {
    /* Encoding properties */
    DmtxPropScheme            = 100,
@@ -178,6 +189,8 @@ typedef enum {
    DmtxPropSquareDevn,
    DmtxPropSymbolSize,
    DmtxPropEdgeThresh,
+   DmtxPropSampleMode,
+   DmtxPropDetectMode,
    /* Image properties */
    DmtxPropWidth             = 300,
    DmtxPropHeight,
@@ -262,6 +275,13 @@ typedef struct DmtxRay2_struct {
 
 typedef unsigned char DmtxByte;
 
+/**
+ * Caller supplied task runner. Must call task(taskArg[i]) once for every i
+ * below taskCount, in any order or concurrently, and return after all have
+ * finished. Tasks share no writable state.
+ */
+typedef void (*DmtxRunTasks)(void (*task)(void *), void **taskArg, int taskCount, void *context);
+
 /**
  * @struct DmtxByteList
  * @brief DmtxByteList
@@ -286,6 +306,7 @@ struct DmtxEncodeStream_struct
    char *reason;              /* Reason for status */
    int sizeIdx;               /* Symbol size of completed stream */
    int fnc1;                  /* Character to represent FNC1, or DmtxUndefined */
+   int padCount;              /* Pad words written to complete the symbol */
    DmtxStatus status;
    DmtxByteList *input;
    DmtxByteList *output;
@@ -409,6 +430,56 @@ typedef struct DmtxMessage_struct {
    unsigned char  *output;        /* Pointer to internal storage of decoded output */
 } DmtxMessage;
 
+/**
+ * @struct DmtxSymbolResult
+ * @brief DmtxSymbolResult
+ */
+typedef struct DmtxSymbolResult_struct {
+   DmtxVector2     corner[4];     /* Image locations of fitted corners 00, 10, 11, 01 */
+   int             sizeIdx;       /* Index of arrays that store Data Matrix constants */
+   int             polarity;
+   int             outputIdx;     /* Offset of decoded data in result list output */
+   int             outputLength;  /* Number of decoded bytes */
+} DmtxSymbolResult;
+
+/**
+ * @struct DmtxResultList
+ * @brief DmtxResultList
+ */
+typedef struct DmtxResultList_struct {
+   int             count;         /* Number of decoded symbols */
+   int             capacity;
+   DmtxSymbolResult *symbol;
+   size_t          outputSize;    /* Size of buffer used to hold decoded data */
+   int             outputIdx;     /* Bytes of output used by all symbols */
+   unsigned char  *output;        /* Decoded data of every symbol, back to back */
+   int             iterations;    /* Total number of scanned locations */
+   DmtxScanStatus  stopCause;     /* Reason that scanning stopped */
+} DmtxResultList;
+
+/**
+ * @struct DmtxVerify
+ * @brief DmtxVerify
+ */
+typedef struct DmtxVerify_struct {
+   int             sizeIdx;       /* Index of arrays that store Data Matrix constants */
+   int             symbolRows;
+   int             symbolCols;
+   unsigned char  *module;        /* Expected state (DmtxTrue = on) of each module, bottom row first */
+   int            *moduleColor;   /* Sampling buffer reused by each verification */
+} DmtxVerify;
+
+/**
+ * @struct DmtxVerifyResult
+ * @brief DmtxVerifyResult
+ */
+typedef struct DmtxVerifyResult_struct {
+   int             moduleCount;   /* Modules compared, including finder and timing */
+   int             mismatchCount; /* Modules read on the wrong side of threshold */
+   double          marginMin;     /* Smallest module margin (1.0 = full contrast) */
+   double          marginMean;    /* Average module margin */
+} DmtxVerifyResult;
+
 /**
  * @struct DmtxScanGrid
  * @brief DmtxScanGrid
@@ -474,6 +545,8 @@ typedef struct DmtxDecode_struct {
    double          squareDevn;
    int             sizeIdxExpected;
    int             edgeThresh;
+   int             sampleMode;
+   int             detectMode;
 
    /* Image modifiers */
    int             xMin;
@@ -487,6 +560,11 @@ typedef struct DmtxDecode_struct {
    unsigned char  *cache;
    DmtxImage      *image;
    DmtxScanGrid    grid;
+   struct DmtxHoughScan_struct *hough;
+   struct DmtxRunScan_struct *runs;
+   struct DmtxRejectCache_struct *reject;
+   DmtxRunTasks    runTasks;
+   void           *runTasksContext;
 } DmtxDecode;
 
 /**
@@ -510,6 +588,22 @@ typedef struct DmtxEncode_struct {
    DmtxMatrix3     rxfrm; /* XXX still necessary? */
 } DmtxEncode;
 
+/**
+ * @struct DmtxEncodeSize
+ * @brief DmtxEncodeSize
+ */
+typedef struct DmtxEncodeSize_struct {
+   int             sizeIdx;       /* Symbol size the message would be encoded in */
+   int             dataWordCount; /* Data codewords holding the message */
+   int             remainingCount;/* Unused data codewords, filled with padding */
+} DmtxEncodeSize;
+
+/**
+ * @struct DmtxEncodePrefix
+ * @brief DmtxEncodePrefix, encoder search paused after a fixed message prefix
+ */
+typedef struct DmtxEncodePrefix_struct DmtxEncodePrefix;
+
 /**
  * @struct DmtxChannel
  * @brief DmtxChannel
@@ -566,17 +660,25 @@ extern int dmtxEncodeGetProp(DmtxEncode *enc, int prop);
     extern DmtxPassFail dmtxEncodeDataMatrix(DmtxEncode *enc, int n, unsigned char *s);
 #endif
 extern DmtxPassFail dmtxEncodeDataMosaic(DmtxEncode *enc, int n, unsigned char *s);
+extern DmtxPassFail dmtxEncodeDataMatrixSize(DmtxEncode *enc, int n, unsigned char *s, DmtxEncodeSize *size);
+extern DmtxEncodePrefix *dmtxEncodePrefixCreate(DmtxEncode *enc, int n, unsigned char *s);
+extern DmtxPassFail dmtxEncodePrefixDestroy(DmtxEncodePrefix **prefix);
+extern DmtxPassFail dmtxEncodeDataMatrixPrefixed(DmtxEncode *enc, DmtxEncodePrefix *prefix, int n, unsigned char *s);
 
 /* dmtxdecode.c */
 extern DmtxDecode *dmtxDecodeCreate(DmtxImage *img, int scale);
 extern DmtxPassFail dmtxDecodeDestroy(DmtxDecode **dec);
+extern DmtxPassFail dmtxDecodeRebindImage(DmtxDecode *dec, DmtxImage *img, DmtxBoolean sceneUnchanged);
+extern DmtxBoolean dmtxDecodeScanComplete(DmtxDecode *dec);
 extern DmtxPassFail dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value);
 extern int dmtxDecodeGetProp(DmtxDecode *dec, int prop);
+extern DmtxPassFail dmtxDecodeSetTaskRunner(DmtxDecode *dec, DmtxRunTasks runTasks, void *context);
 extern /*@exposed@*/ unsigned char *dmtxDecodeGetCache(DmtxDecode *dec, int x, int y);
 extern DmtxPassFail dmtxDecodeGetPixelValue(DmtxDecode *dec, int x, int y, int channel, /*@out@*/ int *value);
 extern DmtxMessage *dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
 extern DmtxMessage *dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix);
 extern DmtxMessage *dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix);
+extern DmtxResultList *dmtxDecodeFindAll(DmtxDecode *dec, DmtxScanConstraint *constraint, int expectedCount, int fix);
 extern unsigned char *dmtxDecodeCreateDiagnostic(DmtxDecode *dec, /*@out@*/ int *totalBytes, /*@out@*/ int *headerBytes, int style);
 
 /* dmtxregion.c */
@@ -592,6 +694,12 @@ extern DmtxPassFail dmtxRegionUpdateXfrms(DmtxDecode *dec, DmtxRegion *reg);
 /* dmtxmessage.c */
 extern DmtxMessage *dmtxMessageCreate(int sizeIdx, int symbolFormat);
 extern DmtxPassFail dmtxMessageDestroy(DmtxMessage **msg);
+extern DmtxPassFail dmtxResultListDestroy(DmtxResultList **results);
+
+/* dmtxverify.c */
+extern DmtxVerify *dmtxVerifyCreate(DmtxEncode *enc, int inputSize, unsigned char *inputString);
+extern DmtxPassFail dmtxVerifyDestroy(DmtxVerify **verify);
+extern DmtxPassFail dmtxVerifyRegion(DmtxDecode *dec, DmtxRegion *reg, DmtxVerify *verify, DmtxVerifyResult *result);
 
 /* dmtximage.c */
 extern DmtxImage *dmtxImageCreate(unsigned char *pxl, int width, int height, int pack);
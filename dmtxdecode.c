@@ -45,6 +45,8 @@ dmtxDecodeCreate(DmtxImage *img, int scale)
    dec->squareDevn = cos(50 * (M_PI/180));
    dec->sizeIdxExpected = DmtxSymbolShapeAuto;
    dec->edgeThresh = 10;
+   dec->sampleMode = DmtxSampleNearest;
+   dec->detectMode = DmtxDetectTrail;
 
    dec->xMin = 0;
    dec->xMax = width - 1;
@@ -78,6 +80,10 @@ dmtxDecodeDestroy(DmtxDecode **dec)
    if((*dec)->cache != NULL)
       free((*dec)->cache);
 
+   HoughScanDestroy(&((*dec)->hough));
+   RunScanDestroy(&((*dec)->runs));
+   RejectCacheDestroy(&((*dec)->reject));
+
    free(*dec);
 
    *dec = NULL;
@@ -85,6 +91,105 @@ dmtxDecodeDestroy(DmtxDecode **dec)
    return DmtxPass;
 }
 
+/**
+ * \brief  Attach a new image (e.g., the next video frame) to an existing
+ *         decode struct. If the caller reports that the scene is unchanged
+ *         then scan grid progress and the pixel cache are carried over, so
+ *         a scan interrupted by a DmtxScanConstraint limit resumes where it
+ *         left off instead of starting again from the first location.
+ * \param  dec
+ * \param  img
+ * \param  sceneUnchanged DmtxTrue to keep scan progress from previous image
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxDecodeRebindImage(DmtxDecode *dec, DmtxImage *img, DmtxBoolean sceneUnchanged)
+{
+   int width, height;
+   int oldWidth, oldHeight;
+   unsigned char *cache;
+
+   if(dec == NULL || img == NULL)
+      return DmtxFail;
+
+   width = dmtxImageGetProp(img, DmtxPropWidth) / dec->scale;
+   height = dmtxImageGetProp(img, DmtxPropHeight) / dec->scale;
+   oldWidth = dmtxDecodeGetProp(dec, DmtxPropWidth);
+   oldHeight = dmtxDecodeGetProp(dec, DmtxPropHeight);
+
+   /* Same geometry: keep cache allocation and region of interest */
+   if(width == oldWidth && height == oldHeight) {
+      dec->image = img;
+
+      if(sceneUnchanged == DmtxTrue)
+         return DmtxPass;
+
+      memset(dec->cache, 0x00, width * height);
+      dec->grid = InitScanGrid(dec);
+      HoughScanReset(dec);
+      RunScanReset(dec);
+      RejectCacheReset(dec);
+
+      return DmtxPass;
+   }
+
+   /* New geometry can't resume anything, so start over with full image */
+   cache = (unsigned char *)calloc(width * height, sizeof(unsigned char));
+   if(cache == NULL)
+      return DmtxFail;
+
+   free(dec->cache);
+   dec->cache = cache;
+   dec->image = img;
+
+   dec->xMin = 0;
+   dec->xMax = width - 1;
+   dec->yMin = 0;
+   dec->yMax = height - 1;
+
+   dec->grid = InitScanGrid(dec);
+   HoughScanReset(dec);
+   RunScanReset(dec);
+   RejectCacheReset(dec);
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Report whether scan grid has visited every location. Callers that
+ *         rebind with sceneUnchanged set can use this to detect when a full
+ *         pass has completed across several images.
+ * \param  dec
+ * \return DmtxTrue | DmtxFalse
+ */
+extern DmtxBoolean
+dmtxDecodeScanComplete(DmtxDecode *dec)
+{
+   DmtxScanGrid grid;
+   DmtxPixelLoc loc;
+
+   if(dec->detectMode == DmtxDetectHough) {
+      if(dec->hough == NULL)
+         return DmtxFalse;
+
+      return (dec->hough->tileIdx >= dec->hough->tileCols * dec->hough->tileRows &&
+            dec->hough->seedIdx >= dec->hough->seedCount) ? DmtxTrue : DmtxFalse;
+   }
+
+   if(dec->detectMode == DmtxDetectRunLength) {
+      if(dec->runs == NULL)
+         return DmtxFalse;
+
+      return (dec->runs->populated == DmtxTrue &&
+            dec->runs->seedIdx >= dec->runs->seedCount) ? DmtxTrue : DmtxFalse;
+   }
+
+   /* Peek on a copy so the real grid still points at the next location */
+   grid = dec->grid;
+
+   return (PopGridLocation(&grid, &loc) == DmtxRangeEnd) ? DmtxTrue : DmtxFalse;
+}
+
 /**
  * \brief  Set decoding behavior property
  * \param  dec
@@ -117,6 +222,12 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
       case DmtxPropEdgeThresh:
          dec->edgeThresh = value;
          break;
+      case DmtxPropSampleMode:
+         dec->sampleMode = value;
+         break;
+      case DmtxPropDetectMode:
+         dec->detectMode = value;
+         break;
       /* Min and Max values arrive unscaled */
       case DmtxPropXmin:
          dec->xMin = value / dec->scale;
@@ -143,8 +254,18 @@ dmtxDecodeSetProp(DmtxDecode *dec, int prop, int value)
    if(dec->edgeThresh < 1 || dec->edgeThresh > 100)
       return DmtxFail;
 
+   if(dec->sampleMode != DmtxSampleNearest && dec->sampleMode != DmtxSampleBilinear)
+      return DmtxFail;
+
+   if(dec->detectMode != DmtxDetectTrail && dec->detectMode != DmtxDetectHough &&
+         dec->detectMode != DmtxDetectRunLength)
+      return DmtxFail;
+
    /* Reinitialize scangrid in case any inputs changed */
    dec->grid = InitScanGrid(dec);
+   HoughScanReset(dec);
+   RunScanReset(dec);
+   RejectCacheReset(dec);
 
    return DmtxPass;
 }
@@ -173,6 +294,10 @@ dmtxDecodeGetProp(DmtxDecode *dec, int prop)
          return dec->sizeIdxExpected;
       case DmtxPropEdgeThresh:
          return dec->edgeThresh;
+      case DmtxPropSampleMode:
+         return dec->sampleMode;
+      case DmtxPropDetectMode:
+         return dec->detectMode;
       case DmtxPropXmin:
          return dec->xMin;
       case DmtxPropXmax:
@@ -194,6 +319,26 @@ dmtxDecodeGetProp(DmtxDecode *dec, int prop)
    return DmtxUndefined;
 }
 
+/**
+ * \brief  Let Reed-Solomon repair of interleaved blocks run through a
+ *         caller supplied executor such as a thread pool
+ * \param  dec
+ * \param  runTasks Runner, or NULL to repair blocks one after another
+ * \param  context Passed unchanged to runTasks
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxDecodeSetTaskRunner(DmtxDecode *dec, DmtxRunTasks runTasks, void *context)
+{
+   if(dec == NULL)
+      return DmtxFail;
+
+   dec->runTasks = runTasks;
+   dec->runTasksContext = (runTasks == NULL) ? NULL : context;
+
+   return DmtxPass;
+}
+
 /**
  * \brief  Returns xxx
  * \param  img
@@ -220,6 +365,162 @@ dmtxDecodeGetCache(DmtxDecode *dec, int x, int y)
    return &(dec->cache[y * width + x]);
 }
 
+/**
+ * \brief  Free rejected edge cache
+ * \param  reject
+ * \return void
+ */
+static void
+RejectCacheDestroy(DmtxRejectCache **reject)
+{
+   if(reject == NULL || *reject == NULL)
+      return;
+
+   free((*reject)->bits);
+   free((*reject)->trail);
+
+   free(*reject);
+   *reject = NULL;
+}
+
+/**
+ * \brief  Forget rejected edges, e.g. because the scene or the settings
+ *         that rejected them have changed
+ * \param  dec
+ * \return void
+ */
+static void
+RejectCacheReset(DmtxDecode *dec)
+{
+   DmtxRejectCache *reject;
+
+   reject = dec->reject;
+   if(reject == NULL)
+      return;
+
+   if(reject->bits != NULL)
+      memset(reject->bits, 0x00, (reject->width * reject->height + 7)/8);
+
+   reject->trailCount = 0;
+}
+
+/**
+ * \brief  Start recording a new continuous trail
+ * \param  dec
+ * \param  loc First trail location
+ * \return void
+ */
+static void
+RejectCacheBeginTrail(DmtxDecode *dec, DmtxPixelLoc loc)
+{
+   if(dec->reject != NULL)
+      dec->reject->trailCount = 0;
+
+   RejectCacheAddTrail(dec, loc);
+}
+
+/**
+ * \brief  Record a location of the continuous trail being blazed
+ * \param  dec
+ * \param  loc
+ * \return void
+ */
+static void
+RejectCacheAddTrail(DmtxDecode *dec, DmtxPixelLoc loc)
+{
+   int trailAlloc;
+   DmtxPixelLoc *trail;
+   DmtxRejectCache *reject;
+
+   if(dec->reject == NULL) {
+      dec->reject = (DmtxRejectCache *)calloc(1, sizeof(DmtxRejectCache));
+      if(dec->reject == NULL)
+         return;
+   }
+
+   reject = dec->reject;
+
+   /* A partial trail still marks a subset of the rejected edge */
+   if(reject->trailCount == reject->trailAlloc) {
+      trailAlloc = (reject->trailAlloc == 0) ? 256 : reject->trailAlloc * 2;
+      trail = (DmtxPixelLoc *)realloc(reject->trail, trailAlloc * sizeof(DmtxPixelLoc));
+      if(trail == NULL)
+         return;
+
+      reject->trail = trail;
+      reject->trailAlloc = trailAlloc;
+   }
+
+   reject->trail[reject->trailCount++] = loc;
+}
+
+/**
+ * \brief  Mark every location of the most recent continuous trail as
+ *         belonging to an edge that didn't lead to a region
+ * \param  dec
+ * \return void
+ */
+static void
+RejectCacheMarkTrail(DmtxDecode *dec)
+{
+   int i, idx;
+   int width, height;
+   DmtxRejectCache *reject;
+
+   reject = dec->reject;
+   if(reject == NULL)
+      return;
+
+   width = dmtxDecodeGetProp(dec, DmtxPropWidth);
+   height = dmtxDecodeGetProp(dec, DmtxPropHeight);
+
+   /* Bits follow the geometry of the image currently bound */
+   if(reject->bits == NULL || reject->width != width || reject->height != height) {
+      free(reject->bits);
+      reject->bits = (unsigned char *)calloc((width * height + 7)/8, sizeof(unsigned char));
+      if(reject->bits == NULL)
+         return;
+      reject->width = width;
+      reject->height = height;
+   }
+
+   for(i = 0; i < reject->trailCount; i++) {
+      if(reject->trail[i].X < 0 || reject->trail[i].X >= width ||
+            reject->trail[i].Y < 0 || reject->trail[i].Y >= height)
+         continue;
+
+      idx = reject->trail[i].Y * width + reject->trail[i].X;
+      reject->bits[idx >> 3] |= (1 << (idx & 0x07));
+   }
+
+   reject->trailCount = 0;
+}
+
+/**
+ * \brief  Check whether location lies on a previously rejected edge
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+RejectCacheTest(DmtxDecode *dec, int x, int y)
+{
+   int idx;
+   DmtxRejectCache *reject;
+
+   reject = dec->reject;
+   if(reject == NULL || reject->bits == NULL)
+      return DmtxFalse;
+
+   if(x < 0 || x >= reject->width || y < 0 || y >= reject->height)
+      return DmtxFalse;
+
+   idx = y * reject->width + x;
+
+   return (reject->bits[idx >> 3] & (1 << (idx & 0x07))) ? DmtxTrue : DmtxFalse;
+}
+
 /**
  *
  *
@@ -332,18 +633,36 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 {
    //fprintf(stdout, "libdmtx::dmtxDecodeMatrixRegion()\n");
    DmtxMessage *msg;
-   DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
-   DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
 
    msg = dmtxMessageCreate(reg->sizeIdx, DmtxFormatMatrix);
    if(msg == NULL)
       return NULL;
 
-   if(PopulateArrayFromMatrix(dec, reg, msg) != DmtxPass) {
+   if(DecodeMatrixRegion(dec, reg, fix, msg) == DmtxFail) {
       dmtxMessageDestroy(&msg);
       return NULL;
    }
 
+   return msg;
+}
+
+/**
+ * \brief  Decode region into an existing message large enough to hold it
+ * \param  dec
+ * \param  reg
+ * \param  fix
+ * \param  msg Cleared message with room for reg->sizeIdx
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg)
+{
+   DmtxVector2 topLeft, topRight, bottomLeft, bottomRight;
+   DmtxPixelLoc pxTopLeft, pxTopRight, pxBottomLeft, pxBottomRight;
+
+   if(PopulateArrayFromMatrix(dec, reg, msg) != DmtxPass)
+      return DmtxFail;
+
    msg->fnc1 = dec->fnc1;
 
    topLeft.X = bottomLeft.X = topLeft.Y = topRight.Y = -0.1;
@@ -365,11 +684,13 @@ dmtxDecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
 
    CacheFillQuad(dec, pxTopLeft, pxTopRight, pxBottomRight, pxBottomLeft);
 
-   return dmtxDecodePopulatedArray(reg->sizeIdx, msg, fix);
+   return DecodePopulatedArray(dec, reg->sizeIdx, msg, fix);
 }
 
 /**
  * \brief  Ripped out a part of dmtxDecodeMatrixRegion function to this one to parse own array
+ *         Modules flagged DmtxModuleUnsure mark their codewords as erasures
+ *         if Reed-Solomon repair fails without them.
  * \param  sizeIdx
  * \param  msg
  * \param  fix
@@ -400,21 +721,100 @@ dmtxDecodePopulatedArray(int sizeIdx, DmtxMessage *msg, int fix)
     *
     */
     
-   ModulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
-
-   if(RsDecode(msg->code, sizeIdx, fix) == DmtxFail){
+   if(DecodePopulatedArray(NULL, sizeIdx, msg, fix) == DmtxFail) {
       dmtxMessageDestroy(&msg);
       msg = NULL;
       return NULL;
    }
 
-   if(DecodeDataStream(msg, sizeIdx, NULL) == DmtxFail) {
-      dmtxMessageDestroy(&msg);
-      msg = NULL;
+   return msg;
+}
+
+/**
+ * \brief  Decode populated array, leaving message allocated on failure
+ * \param  dec Decoder providing task runner, or NULL
+ * \param  sizeIdx
+ * \param  msg
+ * \param  fix
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+DecodePopulatedArray(DmtxDecode *dec, int sizeIdx, DmtxMessage *msg, int fix)
+{
+   DmtxPassFail passFail;
+   DmtxRunTasks runTasks;
+   void *context;
+   unsigned char *erasure;
+
+   runTasks = (dec == NULL) ? NULL : dec->runTasks;
+   context = (dec == NULL) ? NULL : dec->runTasksContext;
+
+   ModulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRed | DmtxModuleOnGreen | DmtxModuleOnBlue);
+
+   if(RsDecode(msg->code, NULL, sizeIdx, fix, runTasks, context) == DmtxFail) {
+
+      /* Retry with codewords holding unsure modules treated as erasures.
+         Blocks repaired by the first attempt now pass their syndrome check. */
+      erasure = FindErasedCodewords(sizeIdx, msg);
+      if(erasure == NULL)
+         return DmtxFail;
+
+      passFail = RsDecode(msg->code, erasure, sizeIdx, fix, runTasks, context);
+      free(erasure);
+
+      if(passFail == DmtxFail)
+         return DmtxFail;
+   }
+
+   if(DecodeDataStream(msg, sizeIdx, NULL) == DmtxFail)
+      return DmtxFail;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Flag codewords containing modules marked DmtxModuleUnsure
+ * \param  sizeIdx
+ * \param  msg Message with populated module array
+ * \return Allocated array holding one flag per codeword, or NULL if no
+ *         module is unsure
+ */
+static unsigned char *
+FindErasedCodewords(int sizeIdx, DmtxMessage *msg)
+{
+   int i, moduleCount, codeCount;
+   DmtxBoolean unsure;
+   unsigned char *modules, *erasure;
+
+   moduleCount = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, sizeIdx) *
+         dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, sizeIdx);
+   codeCount = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx) +
+         dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
+
+   for(unsure = DmtxFalse, i = 0; i < moduleCount && !unsure; i++)
+      unsure = (msg->array[i] & DmtxModuleUnsure) ? DmtxTrue : DmtxFalse;
+
+   if(!unsure)
+      return NULL;
+
+   modules = (unsigned char *)malloc(moduleCount);
+   erasure = (unsigned char *)malloc(codeCount);
+   if(modules == NULL || erasure == NULL) {
+      free(modules);
+      free(erasure);
       return NULL;
    }
 
-   return msg;
+   /* Read unsure marks back through the placement pattern, so each
+      codeword collects one bit per unsure module */
+   for(i = 0; i < moduleCount; i++)
+      modules[i] = DmtxModuleAssigned | ((msg->array[i] & DmtxModuleUnsure) ? DmtxModuleOnRGB : 0);
+
+   ModulePlacementEcc200(modules, erasure, sizeIdx, DmtxModuleOnRGB);
+
+   free(modules);
+
+   return erasure;
 }
 
 /**
@@ -484,6 +884,99 @@ dmtxDecodeMosaicRegion(DmtxDecode *dec, DmtxRegion *reg, int fix)
    return oMsg;
 }
 
+/**
+ * \brief  Scan the whole image and decode every symbol found. Regions and
+ *         messages are decoded into reusable storage, and results are
+ *         collected into one list with a shared output buffer.
+ * \param  dec
+ * \param  constraint Time and iteration limits for the scan as a whole
+ *         (NULL for no limits). Total iterations and stop cause are filled
+ *         in upon return if constraint is non-null.
+ * \param  expectedCount Stop once this many symbols are decoded, or
+ *         DmtxUndefined to scan until the image is exhausted
+ * \param  fix
+ * \return Result list (possibly empty) or NULL in case of failure. Stop
+ *         cause is DmtxScanSuccess if expectedCount was reached and
+ *         DmtxScanNotFound if the scan ran to completion.
+ */
+extern DmtxResultList *
+dmtxDecodeFindAll(DmtxDecode *dec, DmtxScanConstraint *constraint, int expectedCount, int fix)
+{
+   int iterations;
+   DmtxPassFail found;
+   DmtxScanConstraint limit;
+   DmtxRegion reg;
+   DmtxMessage *msg;
+   DmtxResultList *results;
+
+   if(dec == NULL)
+      return NULL;
+
+   results = ResultListCreate();
+   if(results == NULL)
+      return NULL;
+
+   /* One message with room for the largest symbol serves every region */
+   msg = dmtxMessageCreate(DmtxSymbol144x144, DmtxFormatMatrix);
+   if(msg == NULL) {
+      dmtxResultListDestroy(&results);
+      return NULL;
+   }
+
+   iterations = 0;
+
+   for(;;) {
+      if(expectedCount != DmtxUndefined && results->count >= expectedCount) {
+         results->stopCause = DmtxScanSuccess;
+         break;
+      }
+
+      /* Limits apply to the whole scan rather than to each region */
+      memset(&limit, 0x00, sizeof(DmtxScanConstraint));
+      if(constraint != NULL) {
+         limit.maxTimeout = constraint->maxTimeout;
+
+         if(constraint->maxIterations != 0) {
+            if(iterations >= constraint->maxIterations) {
+               results->stopCause = DmtxScanIterLimit;
+               break;
+            }
+            limit.maxIterations = constraint->maxIterations - iterations;
+         }
+      }
+
+      found = RegionFindNext(dec, &limit, &reg);
+      iterations += limit.iterations;
+
+      if(found == DmtxFail) {
+         results->stopCause = limit.stopCause;
+         break;
+      }
+
+      memset(msg->array, 0x00, msg->arraySize);
+      memset(msg->code, 0x00, msg->codeSize);
+      msg->padCount = 0;
+
+      if(DecodeMatrixRegion(dec, &reg, fix, msg) == DmtxPass &&
+            ResultListAdd(results, dec, &reg, msg) == DmtxFail) {
+         dmtxMessageDestroy(&msg);
+         dmtxResultListDestroy(&results);
+         return NULL;
+      }
+   }
+
+   results->iterations = iterations;
+
+   if(constraint != NULL) {
+      constraint->iterations = iterations;
+      constraint->stopCause = results->stopCause;
+   }
+
+   dmtxMessageDestroy(&msg);
+
+   return results;
+}
+
 /**
  *
  *
@@ -568,10 +1061,33 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
    return pnm;
 }
 
+/**
+ * \brief  Sample every module of the symbol (border modules included) once
+ *         and store the resulting intensities in a row-major grid
+ * \param  dec
+ * \param  reg
+ * \param  moduleColor Grid of reg->symbolRows * reg->symbolCols values
+ * \return void
+ */
+static void
+SampleModuleColors(DmtxDecode *dec, DmtxRegion *reg, int *moduleColor)
+{
+   int symbolRow, symbolCol;
+   DmtxModuleSampler sampler;
+
+   ModuleSamplerInit(&sampler, dec, reg, reg->sizeIdx);
+
+   for(symbolRow = 0; symbolRow < reg->symbolRows; symbolRow++) {
+      ModuleSamplerSeek(&sampler, symbolRow, 0, 0, 1);
+      for(symbolCol = 0; symbolCol < reg->symbolCols; symbolCol++)
+         *(moduleColor++) = ModuleSamplerNext(&sampler);
+   }
+}
+
 /**
  * \brief  Increment counters used to determine module values
- * \param  img
  * \param  reg
+ * \param  moduleColor Module intensities captured by SampleModuleColors()
  * \param  tally
  * \param  xOrigin
  * \param  yOrigin
@@ -581,7 +1097,7 @@ dmtxDecodeCreateDiagnostic(DmtxDecode *dec, int *totalBytes, int *headerBytes, i
  * \return void
  */
 static void
-TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir)
+TallyModuleJumps(DmtxRegion *reg, int *moduleColor, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir)
 {
    int extent, weight;
    int travelStep;
@@ -637,7 +1153,7 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
 
 
       *travel = travelStart;
-      color = ReadModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
+      color = moduleColor[symbolRow * reg->symbolCols + symbolCol];
       tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
       statusModule = (travelStep == 1 || (*line & 0x01) == 0) ? DmtxModuleOnRGB : DmtxModuleOff;
@@ -652,7 +1168,7 @@ TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin,
          /* For normal data-bearing modules capture color and decide
             module status based on comparison to previous "known" module */
 
-         color = ReadModuleColor(dec, reg, symbolRow, symbolCol, reg->sizeIdx, reg->flowBegin.plane);
+         color = moduleColor[symbolRow * reg->symbolCols + symbolCol];
          tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
          if(statusPrev == DmtxModuleOnRGB) {
@@ -704,6 +1220,8 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
    int mapCol, mapRow;
    int colTmp, rowTmp, idx;
    int tally[24][24]; /* Large enough to map largest single region */
+   int *moduleColor;
+   double tallyRatio;
 
 /* memset(msg->array, 0x00, msg->arraySize); */
 
@@ -739,6 +1257,13 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
    //dmtxMatrix3Print(reg->fit2raw);
    
 
+   /* Sample each module once and let all four tally passes share it */
+   moduleColor = (int *)malloc(reg->symbolRows * reg->symbolCols * sizeof(int));
+   if(moduleColor == NULL)
+      return DmtxFail;
+
+   SampleModuleColors(dec, reg, moduleColor);
+
    /* Tally module changes for each region in each direction */
    for(yRegionCount = 0; yRegionCount < yRegionTotal; yRegionCount++) {
 
@@ -752,10 +1277,10 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
          //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::xOrigin: %d\n", xOrigin);
 
          memset(tally, 0x00, 24 * 24 * sizeof(int));
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown);
-         TallyModuleJumps(dec, reg, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight);
+         TallyModuleJumps(reg, moduleColor, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirUp);
+         TallyModuleJumps(reg, moduleColor, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirLeft);
+         TallyModuleJumps(reg, moduleColor, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirDown);
+         TallyModuleJumps(reg, moduleColor, tally, xOrigin, yOrigin, mapWidth, mapHeight, DmtxDirRight);
 
          /* Decide module status based on final tallies */
          for(mapRow = 0; mapRow < mapHeight; mapRow++) {
@@ -768,7 +1293,8 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
                idx = (rowTmp * xRegionTotal * mapWidth) + colTmp;
                //fprintf(stdout, "libdmtx::PopulateArrayFromMatrix::idx: %d @ %d,%d\n", idx, mapCol, mapRow);
                //fprintf(stdout, "%c ",tally[mapRow][mapCol]==DmtxModuleOff ? 'X' : ' ');
-               if(tally[mapRow][mapCol]/(double)weightFactor >= 0.5){
+               tallyRatio = tally[mapRow][mapCol]/(double)weightFactor;
+               if(tallyRatio >= 0.5){
                   msg->array[idx] = DmtxModuleOnRGB;
                   //fprintf(stdout, "X ");
                } else {
@@ -776,6 +1302,10 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
                   //fprintf(stdout, "  ");
                }
 
+               /* Passes that disagree leave the module a candidate erasure */
+               if(fabs(tallyRatio - 0.5) < DmtxModuleUnsureMargin)
+                  msg->array[idx] |= DmtxModuleUnsure;
+
                msg->array[idx] |= DmtxModuleAssigned;
             }
             //fprintf(stdout, "\n");
@@ -783,5 +1313,7 @@ PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
       }
    }
 
+   free(moduleColor);
+
    return DmtxPass;
 }
@@ -14,6 +14,72 @@
  * \file dmtxdecodescheme.c
  */
 
+/**
+ * Output for each C40/Text value in each shift set. Negative entries are
+ * DmtxC40Text* actions. Rows are indexed by value + 1 because a malformed
+ * codeword pair unpacks to values from -1 to 40, and those keep decoding
+ * the way they always have.
+ */
+static const short c40TextOutput[2][4][42] =
+{
+   {
+      { /* C40 basic set */
+           -1,   -2,   -3,   -4,   32,   48,   49,   50,   51,   52,   53,   54,   55,   56,
+           57,   65,   66,   67,   68,   69,   70,   71,   72,   73,   74,   75,   76,   77,
+           78,   79,   80,   81,   82,   83,   84,   85,   86,   87,   88,   89,   90,   -1
+      },
+      { /* C40 shift 1 */
+          255,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,
+           13,   14,   15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25,   26,
+           27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40
+      },
+      { /* C40 shift 2 */
+           32,   33,   34,   35,   36,   37,   38,   39,   40,   41,   42,   43,   44,   45,
+           46,   47,   58,   59,   60,   61,   62,   63,   64,   91,   92,   93,   94,   95,
+           -6,   -1,   -1,   -5,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1
+      },
+      { /* C40 shift 3 */
+           95,   96,   97,   98,   99,  100,  101,  102,  103,  104,  105,  106,  107,  108,
+          109,  110,  111,  112,  113,  114,  115,  116,  117,  118,  119,  120,  121,  122,
+          123,  124,  125,  126,  127,  128,  129,  130,  131,  132,  133,  134,  135,  136
+      }
+   },
+   {
+      { /* Text basic set */
+           -1,   -2,   -3,   -4,   32,   48,   49,   50,   51,   52,   53,   54,   55,   56,
+           57,   97,   98,   99,  100,  101,  102,  103,  104,  105,  106,  107,  108,  109,
+          110,  111,  112,  113,  114,  115,  116,  117,  118,  119,  120,  121,  122,   -1
+      },
+      { /* Text shift 1 */
+          255,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,
+           13,   14,   15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25,   26,
+           27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40
+      },
+      { /* Text shift 2 */
+           32,   33,   34,   35,   36,   37,   38,   39,   40,   41,   42,   43,   44,   45,
+           46,   47,   58,   59,   60,   61,   62,   63,   64,   91,   92,   93,   94,   95,
+           -6,   -1,   -1,   -5,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1,   -1
+      },
+      { /* Text shift 3 */
+           63,   96,   65,   66,   67,   68,   69,   70,   71,   72,   73,   74,   75,   76,
+           77,   78,   79,   80,   81,   82,   83,   84,   85,   86,   87,   88,   89,   90,
+          123,  124,  125,  126,  127,  128,  129,  130,  131,  132,  133,  134,  135,  136
+      }
+   }
+};
+
+/* Output for each X12 value, indexed by value + 1 as above */
+static const unsigned char x12Output[42] =
+   {  43,  13,  42,  62,  32,  48,  49,  50,  51,  52,  53,  54,  55,  56,
+      57,  65,  66,  67,  68,  69,  70,  71,  72,  73,  74,  75,  76,  77,
+      78,  79,  80,  81,  82,  83,  84,  85,  86,  87,  88,  89,  90,  91 };
+
+/* Both digits of each ASCII digit pair codeword (130-229) */
+static const char asciiDigitPairs[] =
+      "00010203040506070809101112131415161718192021222324252627282930313233"
+      "34353637383940414243444546474849505152535455565758596061626364656667"
+      "6869707172737475767778798081828384858687888990919293949596979899";
+
 /**
  * \brief  Translate encoded data stream into final output
  * \param  msg
@@ -145,28 +211,6 @@ ValidOutputWord(int value)
    return (value >= 0 && value < 256) ? DmtxTrue : DmtxFalse;
 }
 
-/**
- *
- *
- */
-static void
-PushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value)
-{
-   assert(value >= 0 && value < 256);
-
-   msg->output[msg->outputIdx] = (unsigned char)value;
-
-   if(state->upperShift == DmtxTrue) {
-      assert(value < 128);
-      msg->output[msg->outputIdx] += 128;
-   }
-
-   msg->outputIdx++;
-
-   state->shift = DmtxC40TextBasicSet;
-   state->upperShift = DmtxFalse;
-}
-
 /**
  *
  *
@@ -212,10 +256,28 @@ static unsigned char *
 DecodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
 {
    int upperShift = DmtxFalse;
+   unsigned char *output;
 
    while(ptr < dataEnd) {
       int codeword = (int)(*ptr);
 
+      /* Plain ASCII and digit pairs are the bulk of most symbols */
+      if(upperShift == DmtxFalse) {
+         output = msg->output + msg->outputIdx;
+         if(codeword >= 1 && codeword <= 128) {
+            output[0] = (unsigned char)(codeword - 1);
+            msg->outputIdx++;
+            ptr++;
+            continue;
+         }
+         else if(codeword >= 130 && codeword <= 229) {
+            memcpy(output, asciiDigitPairs + 2 * (codeword - 130), 2);
+            msg->outputIdx += 2;
+            ptr++;
+            continue;
+         }
+      }
+
       if(GetEncodationScheme(*ptr) != DmtxSchemeAscii)
          return ptr;
       else
@@ -240,14 +302,6 @@ DecodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
       else if(codeword == 0 || codeword >= 242) {
         return ptr;
       }
-      else if(codeword <= 128) {
-         PushOutputWord(msg, codeword - 1);
-      }
-      else if(codeword <= 229) {
-         int digits = codeword - 130;
-         PushOutputWord(msg, digits/10 + '0');
-         PushOutputWord(msg, digits - (digits/10)*10 + '0');
-      }
       else if(codeword == DmtxValueFNC1) {
          if(msg->fnc1 != DmtxUndefined) {
              int pushword = msg->fnc1;
@@ -273,19 +327,24 @@ static unsigned char *
 DecodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd, DmtxScheme encScheme)
 {
    int i;
-   int packed;
+   int packed, entry;
+   int shift, upperShift;
    int c40Values[3];
-   C40TextState state;
-
-   state.shift = DmtxC40TextBasicSet;
-   state.upperShift = DmtxFalse;
+   const short (*table)[42];
+   unsigned char *output;
 
    assert(encScheme == DmtxSchemeC40 || encScheme == DmtxSchemeText);
+   table = c40TextOutput[(encScheme == DmtxSchemeC40) ? 0 : 1];
 
    /* Unlatch is implied if only one codeword remains */
    if(dataEnd - ptr < 2)
       return ptr;
 
+   /* Upper Shift is kept as the offset it adds to the next output word */
+   shift = DmtxC40TextBasicSet;
+   upperShift = 0;
+   output = msg->output + msg->outputIdx;
+
    while(ptr < dataEnd) {
 
       /* FIXME Also check that ptr+1 is safe to access */
@@ -296,72 +355,39 @@ DecodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd
       ptr += 2;
 
       for(i = 0; i < 3; i++) {
-         if(state.shift == DmtxC40TextBasicSet) { /* Basic set */
-            if(c40Values[i] <= 2) {
-               state.shift = c40Values[i] + 1;
-            }
-            else if(c40Values[i] == 3) {
-               PushOutputC40TextWord(msg, &state, ' ');
-            }
-            else if(c40Values[i] <= 13) {
-               PushOutputC40TextWord(msg, &state, c40Values[i] - 13 + '9'); /* 0-9 */
-            }
-            else if(c40Values[i] <= 39) {
-               if(encScheme == DmtxSchemeC40) {
-                  PushOutputC40TextWord(msg, &state, c40Values[i] - 39 + 'Z'); /* A-Z */
-               }
-               else if(encScheme == DmtxSchemeText) {
-                  PushOutputC40TextWord(msg, &state, c40Values[i] - 39 + 'z'); /* a-z */
-               }
-            }
-         }
-         else if(state.shift == DmtxC40TextShift1) { /* Shift 1 set */
-            PushOutputC40TextWord(msg, &state, c40Values[i]); /* ASCII 0 - 31 */
+         entry = table[shift][c40Values[i] + 1];
+
+         if(entry == DmtxC40TextFnc1 && msg->fnc1 != DmtxUndefined)
+            entry = msg->fnc1;
+
+         if(entry >= 0) {
+            *(output++) = (unsigned char)(entry + upperShift);
+            shift = DmtxC40TextBasicSet;
+            upperShift = 0;
          }
-         else if(state.shift == DmtxC40TextShift2) { /* Shift 2 set */
-            if(c40Values[i] <= 14) {
-               PushOutputC40TextWord(msg, &state, c40Values[i] + 33); /* ASCII 33 - 47 */
-            }
-            else if(c40Values[i] <= 21) {
-               PushOutputC40TextWord(msg, &state, c40Values[i] + 43); /* ASCII 58 - 64 */
-            }
-            else if(c40Values[i] <= 26) {
-               PushOutputC40TextWord(msg, &state, c40Values[i] + 69); /* ASCII 91 - 95 */
-            }
-            else if(c40Values[i] == 27) {
-               if(msg->fnc1 != DmtxUndefined) {
-                   PushOutputC40TextWord(msg, &state, msg->fnc1);
-               }
-            }
-            else if(c40Values[i] == 30) {
-               state.upperShift = DmtxTrue;
-               state.shift = DmtxC40TextBasicSet;
-            }
+         else if(entry == DmtxC40TextUpperShift) {
+            shift = DmtxC40TextBasicSet;
+            upperShift = 128;
          }
-         else if(state.shift == DmtxC40TextShift3) { /* Shift 3 set */
-            if(encScheme == DmtxSchemeC40) {
-               PushOutputC40TextWord(msg, &state, c40Values[i] + 96);
-            }
-            else if(encScheme == DmtxSchemeText) {
-               if(c40Values[i] == 0)
-                  PushOutputC40TextWord(msg, &state, c40Values[i] + 96);
-               else if(c40Values[i] <= 26)
-                  PushOutputC40TextWord(msg, &state, c40Values[i] - 26 + 'Z'); /* A-Z */
-               else
-                  PushOutputC40TextWord(msg, &state, c40Values[i] - 31 + 127); /* { | } ~ DEL */
-            }
+         else if(entry != DmtxC40TextNoOutput && entry != DmtxC40TextFnc1) {
+            shift = DmtxC40TextToShift1 - entry + DmtxC40TextShift1;
          }
       }
 
       /* Unlatch if codeword 254 follows 2 codewords in C40/Text encodation */
-      if(*ptr == DmtxValueCTXUnlatch)
-         return ptr + 1;
+      if(*ptr == DmtxValueCTXUnlatch) {
+         ptr++;
+         break;
+      }
 
       /* Unlatch is implied if only one codeword remains */
       if(dataEnd - ptr < 2)
-         return ptr;
+         break;
    }
 
+   assert(output - msg->output <= INT_MAX);
+   msg->outputIdx = (int)(output - msg->output);
+
    return ptr;
 }
 
@@ -375,9 +401,9 @@ DecodeSchemeC40Text(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd
 static unsigned char *
 DecodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
 {
-   int i;
    int packed;
    int x12Values[3];
+   unsigned char *output;
 
    /* Unlatch is implied if only one codeword remains */
    if(dataEnd - ptr < 2)
@@ -392,20 +418,11 @@ DecodeSchemeX12(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd)
       x12Values[2] =  (packed - 1) % 40;
       ptr += 2;
 
-      for(i = 0; i < 3; i++) {
-         if(x12Values[i] == 0)
-            PushOutputWord(msg, 13);
-         else if(x12Values[i] == 1)
-            PushOutputWord(msg, 42);
-         else if(x12Values[i] == 2)
-            PushOutputWord(msg, 62);
-         else if(x12Values[i] == 3)
-            PushOutputWord(msg, 32);
-         else if(x12Values[i] <= 13)
-            PushOutputWord(msg, x12Values[i] + 44);
-         else if(x12Values[i] <= 90)
-            PushOutputWord(msg, x12Values[i] + 51);
-      }
+      output = msg->output + msg->outputIdx;
+      output[0] = x12Output[x12Values[0] + 1];
+      output[1] = x12Output[x12Values[1] + 1];
+      output[2] = x12Output[x12Values[2] + 1];
+      msg->outputIdx += 3;
 
       /* Unlatch if codeword 254 follows 2 codewords in C40/Text encodation */
       if(*ptr == DmtxValueCTXUnlatch)
@@ -458,7 +475,8 @@ DecodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd
             return ptr;
          }
 
-         PushOutputWord(msg, unpacked[i] ^ (((unpacked[i] & 0x20) ^ 0x20) << 1));
+         /* Values 0-31 stand for ASCII 64-95 */
+         msg->output[msg->outputIdx++] = unpacked[i] ^ (((unpacked[i] & 0x20) ^ 0x20) << 1);
       }
 
       /* Unlatch is implied if fewer than 3 codewords remain */
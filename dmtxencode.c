@@ -176,9 +176,7 @@ dmtxEncodeGetProp(DmtxEncode *enc, int prop)
     dmtxEncodeDataMatrix(DmtxEncode *enc, int inputSize, unsigned char *inputString)
 #endif
 {
-   int sizeIdx;
-   int width, height, bitsPerPixel;
-   unsigned char *pxl;
+   int sizeIdx, padCount;
    DmtxByte outputStorage[4096];
    DmtxByteList output = dmtxByteListBuild(outputStorage, sizeof(outputStorage));
    DmtxByteList input = dmtxByteListBuild(inputString, inputSize);
@@ -190,16 +188,41 @@ dmtxEncodeGetProp(DmtxEncode *enc, int prop)
 
    /* Encode input string into data codewords */
    #ifdef HAVE_READER_PROGRAMMING
-        sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, bReaderProgramming);
+        sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount, bReaderProgramming);
    #else
-        sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1);
+        sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount);
    #endif
    if(sizeIdx == DmtxUndefined || output.length <= 0)
       return DmtxFail;
 
+   return EncodeSymbolImage(enc, &output, sizeIdx, padCount);
+}
+
+/**
+ * \brief  Build symbol image from encoded data codewords
+ * \param  enc
+ * \param  output Data codewords
+ * \param  sizeIdx
+ * \param  padCount Number of pad words following the message
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+EncodeSymbolImage(DmtxEncode *enc, DmtxByteList *output, int sizeIdx, int padCount)
+{
+   int width, height, bitsPerPixel;
+   unsigned char *pxl;
+
    /* EncodeDataCodewords() should have updated any auto sizeIdx to a real one */
    assert(sizeIdx != DmtxSymbolSquareAuto && sizeIdx != DmtxSymbolRectAuto);
 
+   /* Release symbol from a previous call so one encoder can serve a run */
+   if(enc->image != NULL && enc->image->pxl != NULL) {
+      free(enc->image->pxl);
+      enc->image->pxl = NULL;
+   }
+   dmtxImageDestroy(&(enc->image));
+   dmtxMessageDestroy(&(enc->message));
+
    /* XXX we can remove a lot of this redundant data */
    enc->region.sizeIdx = sizeIdx;
    enc->region.symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
@@ -209,8 +232,10 @@ dmtxEncodeGetProp(DmtxEncode *enc, int prop)
 
    /* Allocate memory for message and array */
    enc->message = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
-   enc->message->padCount = 0; /* XXX this needs to be added back */
-   memcpy(enc->message->code, output.b, output.length);
+   if(enc->message == NULL)
+      return DmtxFail;
+   enc->message->padCount = padCount;
+   memcpy(enc->message->code, output->b, output->length);
 
    /* Generate error correction codewords */
    RsEncode(enc->message, enc->region.sizeIdx);
@@ -248,6 +273,160 @@ dmtxEncodeGetProp(DmtxEncode *enc, int prop)
    return DmtxPass;
 }
 
+/**
+ * \brief  Find symbol size a message would be encoded in without building
+ *         the symbol. Nothing is allocated on the heap, so this is cheap
+ *         enough to call while laying out labels.
+ * \param  enc Encoder providing scheme, size request, and FNC1 settings
+ * \param  inputSize
+ * \param  inputString
+ * \param  size Receives symbol size and data codeword usage
+ * \return DmtxPass | DmtxFail if message can't be encoded
+ */
+extern DmtxPassFail
+dmtxEncodeDataMatrixSize(DmtxEncode *enc, int inputSize, unsigned char *inputString, DmtxEncodeSize *size)
+{
+   int sizeIdx, padCount;
+   DmtxByte outputStorage[4096];
+   DmtxByteList output = dmtxByteListBuild(outputStorage, sizeof(outputStorage));
+   DmtxByteList input = dmtxByteListBuild(inputString, inputSize);
+
+   if(enc == NULL || inputString == NULL || size == NULL)
+      return DmtxFail;
+
+   input.length = inputSize;
+
+   /* AutoBest only needs the winning size, not the codewords behind it */
+   if(enc->scheme == DmtxSchemeAutoBest)
+      sizeIdx = EncodeOptimizeBest(&input, NULL, enc->sizeIdxRequest, enc->fnc1, &padCount);
+   else
+#ifdef HAVE_READER_PROGRAMMING
+      sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount, DmtxFalse);
+#else
+      sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount);
+#endif
+   if(sizeIdx == DmtxUndefined)
+      return DmtxFail;
+
+   size->sizeIdx = sizeIdx;
+   size->dataWordCount = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx) - padCount;
+   size->remainingCount = padCount;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Search a fixed message prefix once for use by a run of labels that
+ *         all start with it. The encoder's size request and FNC1 setting are
+ *         captured with the prefix.
+ * \param  enc
+ * \param  prefixSize
+ * \param  prefixString
+ * \return Address of allocated memory, or NULL if prefix can't be searched
+ */
+extern DmtxEncodePrefix *
+dmtxEncodePrefixCreate(DmtxEncode *enc, int prefixSize, unsigned char *prefixString)
+{
+   DmtxEncodePrefix *prefix;
+
+   if(enc == NULL || prefixString == NULL || prefixSize <= 0 || prefixSize > DmtxEncodeInputMax)
+      return NULL;
+
+   prefix = (DmtxEncodePrefix *)calloc(1, sizeof(DmtxEncodePrefix));
+   if(prefix == NULL)
+      return NULL;
+
+   prefix->sizeIdxRequest = enc->sizeIdxRequest;
+   prefix->fnc1 = enc->fnc1;
+   prefix->length = prefixSize;
+
+   prefix->b = (DmtxByte *)malloc(prefixSize);
+   if(prefix->b == NULL) {
+      dmtxEncodePrefixDestroy(&prefix);
+      return NULL;
+   }
+   memcpy(prefix->b, prefixString, prefixSize);
+
+   if(EncodeOptimizePrefix(prefix) == DmtxFail) {
+      dmtxEncodePrefixDestroy(&prefix);
+      return NULL;
+   }
+
+   return prefix;
+}
+
+/**
+ * \brief  Free message prefix
+ * \param  prefix
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxEncodePrefixDestroy(DmtxEncodePrefix **prefix)
+{
+   if(prefix == NULL || *prefix == NULL)
+      return DmtxFail;
+
+   if((*prefix)->b != NULL)
+      free((*prefix)->b);
+
+   if((*prefix)->step != NULL)
+      free((*prefix)->step);
+
+   free(*prefix);
+
+   *prefix = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Convert prefix and suffix into Data Matrix image. With
+ *         DmtxSchemeAutoBest and the settings the prefix was created with,
+ *         the search resumes after the prefix. Otherwise the whole message
+ *         is encoded as usual. Either way the symbol matches the one
+ *         dmtxEncodeDataMatrix() builds for the joined message.
+ * \param  enc
+ * \param  prefix
+ * \param  suffixSize
+ * \param  suffixString
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxEncodeDataMatrixPrefixed(DmtxEncode *enc, DmtxEncodePrefix *prefix, int suffixSize, unsigned char *suffixString)
+{
+   int sizeIdx, padCount;
+   DmtxByte inputStorage[DmtxEncodeInputMax];
+   DmtxByte outputStorage[4096];
+   DmtxByteList output = dmtxByteListBuild(outputStorage, sizeof(outputStorage));
+   DmtxByteList input = dmtxByteListBuild(inputStorage, sizeof(inputStorage));
+
+   if(enc == NULL || prefix == NULL || suffixSize < 0 || (suffixSize > 0 && suffixString == NULL))
+      return DmtxFail;
+
+   /* Longer messages don't fit any symbol */
+   if(prefix->length + suffixSize > DmtxEncodeInputMax)
+      return DmtxFail;
+
+   memcpy(inputStorage, prefix->b, prefix->length);
+   if(suffixSize > 0)
+      memcpy(inputStorage + prefix->length, suffixString, suffixSize);
+   input.length = prefix->length + suffixSize;
+
+   if(enc->scheme == DmtxSchemeAutoBest && enc->sizeIdxRequest == prefix->sizeIdxRequest &&
+         enc->fnc1 == prefix->fnc1)
+      sizeIdx = EncodeOptimizeBestPrefixed(prefix, &input, &output, &padCount);
+   else
+#ifdef HAVE_READER_PROGRAMMING
+      sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount, DmtxFalse);
+#else
+      sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount);
+#endif
+   if(sizeIdx == DmtxUndefined || output.length <= 0)
+      return DmtxFail;
+
+   return EncodeSymbolImage(enc, &output, sizeIdx, padCount);
+}
+
 /**
  * \brief  Convert message into Data Mosaic image
  *
@@ -312,9 +491,11 @@ dmtxEncodeDataMosaic(DmtxEncode *enc, int inputSize, unsigned char *inputString)
       encG = dmtxEncodeCreate();
       encB = dmtxEncodeCreate();
 
-      /* Copy all settings from master DmtxEncode, including pointer to image
-         and message, which is initially null */
+      /* Copy all settings from master DmtxEncode, but not the image and
+         message of an earlier symbol, which only the master may free */
       *encR = *encG = *encB = *enc;
+      encR->image = encG->image = encB->image = NULL;
+      encR->message = encG->message = encB->message = NULL;
 
       dmtxEncodeSetProp(encR, DmtxPropSizeRequest, sizeIdxAttempt);
       dmtxEncodeSetProp(encG, DmtxPropSizeRequest, sizeIdxAttempt);
@@ -412,6 +593,7 @@ dmtxEncodeDataMosaic(DmtxEncode *enc, int inputSize, unsigned char *inputString)
  * \param  inputSize
  * \param  scheme
  * \param  sizeIdx
+ * \param  padCount Receives number of pad words following the message
  * \param  bReaderProgramming
  * \return Count of encoded data words
  *
@@ -420,10 +602,10 @@ dmtxEncodeDataMosaic(DmtxEncode *enc, int inputSize, unsigned char *inputString)
  */
 #ifdef HAVE_READER_PROGRAMMING
     static int
-    EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, DmtxBoolean bReaderProgramming)
+    EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount, DmtxBoolean bReaderProgramming)
 #else
     static int
-    EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1)
+    EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount)
 #endif
 {
    int sizeIdx;
@@ -432,16 +614,16 @@ dmtxEncodeDataMosaic(DmtxEncode *enc, int inputSize, unsigned char *inputString)
    switch(scheme)
    {
       case DmtxSchemeAutoBest:
-         sizeIdx = EncodeOptimizeBest(input, output, sizeIdxRequest, fnc1);
+         sizeIdx = EncodeOptimizeBest(input, output, sizeIdxRequest, fnc1, padCount);
          break;
       case DmtxSchemeAutoFast:
-         sizeIdx = DmtxUndefined; /* EncodeAutoFast(input, output, sizeIdxRequest, passFail); */
+         sizeIdx = EncodeAutoFast(input, output, sizeIdxRequest, fnc1, padCount);
          break;
       default:
          #ifdef HAVE_READER_PROGRAMMING
-            sizeIdx = EncodeSingleScheme(input, output, sizeIdxRequest, scheme, fnc1, bReaderProgramming);
+            sizeIdx = EncodeSingleScheme(input, output, sizeIdxRequest, scheme, fnc1, padCount, bReaderProgramming);
          #else
-            sizeIdx = EncodeSingleScheme(input, output, sizeIdxRequest, scheme, fnc1);
+            sizeIdx = EncodeSingleScheme(input, output, sizeIdxRequest, scheme, fnc1, padCount);
          #endif
          break;
    }
@@ -138,6 +138,7 @@ PadRemainingInAscii(DmtxEncodeStream *stream, int sizeIdx)
    CHKSIZE;
 
    symbolRemaining = GetRemainingSymbolCapacity(stream->output->length, sizeIdx);
+   stream->padCount = symbolRemaining;
 
    /* First pad character is not randomized */
    if(symbolRemaining > 0)
@@ -185,12 +186,15 @@ EncodeTmpRemainingInAscii(DmtxEncodeStream *stream, DmtxByte *storage,
    }
 
    /*
-    * We stopped encoding before attempting to write beyond output boundary so
-    * any stream errors are truly unexpected. The passFail status indicates
-    * whether output.length can be trusted by the calling function.
+    * We stopped encoding before attempting to write beyond output boundary, so
+    * the only expected error is an Upper Shift pair that straddled the last
+    * position. That leaves output full, which callers already read as "does
+    * not fit." Anything else is truly unexpected. The passFail status
+    * indicates whether output.length can be trusted by the calling function.
     */
 
-   if(streamAscii.status == DmtxStatusInvalid || streamAscii.status == DmtxStatusFatal)
+   if(streamAscii.status == DmtxStatusInvalid || (streamAscii.status == DmtxStatusFatal &&
+         dmtxByteListHasCapacity(streamAscii.output)))
       *passFail = DmtxFail;
    else
       *passFail = DmtxPass;
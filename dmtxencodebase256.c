@@ -55,6 +55,73 @@ AppendValueBase256(DmtxEncodeStream *stream, DmtxByte value)
    UpdateBase256ChainHeader(stream, DmtxUndefined); CHKERR;
 }
 
+/**
+ * \brief  Encode a run of input up to the next FNC1 (or end of input) as one
+ *         Base 256 chain. The header size follows from the run length, so
+ *         every byte is randomized once at its final position instead of
+ *         shifting the chain when the header grows to two bytes.
+ * \param  stream
+ * \param  sizeIdxRequest
+ * \return DmtxPass | DmtxFail if no chain can start here, leaving stream unchanged
+ */
+static DmtxPassFail
+EncodeBase256Run(DmtxEncodeStream *stream, int sizeIdxRequest)
+{
+   int i, count, chainStart, headerByteCount;
+   int pseudoRandom;
+   DmtxByte *inputRun, *outputRun;
+   DmtxByteList *output = stream->output;
+
+   /* Only start fresh chains, since an open one already has its header */
+   if(stream->currentScheme == DmtxSchemeBase256)
+      return DmtxFail;
+
+   inputRun = stream->input->b + stream->inputNext;
+   for(count = 0; count < stream->input->length - stream->inputNext; count++)
+   {
+      if(stream->fnc1 != DmtxUndefined && (int)inputRun[count] == stream->fnc1)
+         break;
+   }
+
+   if(count == 0)
+      return DmtxFail;
+
+   /* Latch writes a single header byte for the empty chain */
+   EncodeChangeScheme(stream, DmtxSchemeBase256, DmtxUnlatchExplicit);
+   if(stream->status != DmtxStatusEncoding)
+      return DmtxPass;
+
+   chainStart = output->length - 1;
+   headerByteCount = (count > 249) ? 2 : 1;
+   if(chainStart + headerByteCount + count > output->capacity)
+   {
+      StreamMarkFatal(stream, DmtxErrorOutOfBounds);
+      return DmtxPass;
+   }
+
+   /* Randomize255State() with its pseudo-random term stepped per position */
+   outputRun = output->b + chainStart + headerByteCount;
+   pseudoRandom = (149 * (chainStart + headerByteCount + 1)) % 255;
+   for(i = 0; i < count; i++)
+   {
+      outputRun[i] = (DmtxByte)(inputRun[i] + pseudoRandom + 1);
+      pseudoRandom = (pseudoRandom >= 106) ? pseudoRandom - 106 : pseudoRandom + 149;
+   }
+
+   output->length = chainStart + headerByteCount + count;
+   stream->outputChainWordCount = headerByteCount + count;
+   stream->outputChainValueCount = count;
+   stream->inputNext += count;
+
+   UpdateBase256ChainHeader(stream, DmtxUndefined);
+   if(stream->status != DmtxStatusEncoding)
+      return DmtxPass;
+
+   CompleteIfDoneBase256(stream, sizeIdxRequest);
+
+   return DmtxPass;
+}
+
 /**
  * check remaining symbol capacity and remaining codewords
  * if the chain can finish perfectly at the end of symbol data words there is a
@@ -23,8 +23,73 @@
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) { StreamMarkFatal(stream, DmtxErrorUnknown); return; } }
 
-#undef RETURN_IF_FAIL
-#define RETURN_IF_FAIL { if(*passFail == DmtxFail) return; }
+/**
+ * C40, Text, and X12 values for each ASCII input, as {count, value, value}.
+ * A count of 0 means the scheme can't encode the input. Extended ASCII is
+ * written as Shift 2 + Upper Shift followed by the entry for (input - 128),
+ * and FNC1 is handled separately since its value is chosen at runtime.
+ */
+static const DmtxByte ctxC40Values[128][3] =
+{
+   {2, 0, 0}, {2, 0, 1}, {2, 0, 2}, {2, 0, 3}, {2, 0, 4}, {2, 0, 5}, {2, 0, 6}, {2, 0, 7},
+   {2, 0, 8}, {2, 0, 9}, {2, 0,10}, {2, 0,11}, {2, 0,12}, {2, 0,13}, {2, 0,14}, {2, 0,15},
+   {2, 0,16}, {2, 0,17}, {2, 0,18}, {2, 0,19}, {2, 0,20}, {2, 0,21}, {2, 0,22}, {2, 0,23},
+   {2, 0,24}, {2, 0,25}, {2, 0,26}, {2, 0,27}, {2, 0,28}, {2, 0,29}, {2, 0,30}, {2, 0,31},
+   {1, 3, 0}, {2, 1, 0}, {2, 1, 1}, {2, 1, 2}, {2, 1, 3}, {2, 1, 4}, {2, 1, 5}, {2, 1, 6},
+   {2, 1, 7}, {2, 1, 8}, {2, 1, 9}, {2, 1,10}, {2, 1,11}, {2, 1,12}, {2, 1,13}, {2, 1,14},
+   {1, 4, 0}, {1, 5, 0}, {1, 6, 0}, {1, 7, 0}, {1, 8, 0}, {1, 9, 0}, {1,10, 0}, {1,11, 0},
+   {1,12, 0}, {1,13, 0}, {2, 1,15}, {2, 1,16}, {2, 1,17}, {2, 1,18}, {2, 1,19}, {2, 1,20},
+   {2, 1,21}, {1,14, 0}, {1,15, 0}, {1,16, 0}, {1,17, 0}, {1,18, 0}, {1,19, 0}, {1,20, 0},
+   {1,21, 0}, {1,22, 0}, {1,23, 0}, {1,24, 0}, {1,25, 0}, {1,26, 0}, {1,27, 0}, {1,28, 0},
+   {1,29, 0}, {1,30, 0}, {1,31, 0}, {1,32, 0}, {1,33, 0}, {1,34, 0}, {1,35, 0}, {1,36, 0},
+   {1,37, 0}, {1,38, 0}, {1,39, 0}, {2, 1,22}, {2, 1,23}, {2, 1,24}, {2, 1,25}, {2, 1,26},
+   {2, 2, 0}, {2, 2, 1}, {2, 2, 2}, {2, 2, 3}, {2, 2, 4}, {2, 2, 5}, {2, 2, 6}, {2, 2, 7},
+   {2, 2, 8}, {2, 2, 9}, {2, 2,10}, {2, 2,11}, {2, 2,12}, {2, 2,13}, {2, 2,14}, {2, 2,15},
+   {2, 2,16}, {2, 2,17}, {2, 2,18}, {2, 2,19}, {2, 2,20}, {2, 2,21}, {2, 2,22}, {2, 2,23},
+   {2, 2,24}, {2, 2,25}, {2, 2,26}, {2, 2,27}, {2, 2,28}, {2, 2,29}, {2, 2,30}, {2, 2,31}
+};
+
+static const DmtxByte ctxTextValues[128][3] =
+{
+   {2, 0, 0}, {2, 0, 1}, {2, 0, 2}, {2, 0, 3}, {2, 0, 4}, {2, 0, 5}, {2, 0, 6}, {2, 0, 7},
+   {2, 0, 8}, {2, 0, 9}, {2, 0,10}, {2, 0,11}, {2, 0,12}, {2, 0,13}, {2, 0,14}, {2, 0,15},
+   {2, 0,16}, {2, 0,17}, {2, 0,18}, {2, 0,19}, {2, 0,20}, {2, 0,21}, {2, 0,22}, {2, 0,23},
+   {2, 0,24}, {2, 0,25}, {2, 0,26}, {2, 0,27}, {2, 0,28}, {2, 0,29}, {2, 0,30}, {2, 0,31},
+   {1, 3, 0}, {2, 1, 0}, {2, 1, 1}, {2, 1, 2}, {2, 1, 3}, {2, 1, 4}, {2, 1, 5}, {2, 1, 6},
+   {2, 1, 7}, {2, 1, 8}, {2, 1, 9}, {2, 1,10}, {2, 1,11}, {2, 1,12}, {2, 1,13}, {2, 1,14},
+   {1, 4, 0}, {1, 5, 0}, {1, 6, 0}, {1, 7, 0}, {1, 8, 0}, {1, 9, 0}, {1,10, 0}, {1,11, 0},
+   {1,12, 0}, {1,13, 0}, {2, 1,15}, {2, 1,16}, {2, 1,17}, {2, 1,18}, {2, 1,19}, {2, 1,20},
+   {2, 1,21}, {2, 2, 1}, {2, 2, 2}, {2, 2, 3}, {2, 2, 4}, {2, 2, 5}, {2, 2, 6}, {2, 2, 7},
+   {2, 2, 8}, {2, 2, 9}, {2, 2,10}, {2, 2,11}, {2, 2,12}, {2, 2,13}, {2, 2,14}, {2, 2,15},
+   {2, 2,16}, {2, 2,17}, {2, 2,18}, {2, 2,19}, {2, 2,20}, {2, 2,21}, {2, 2,22}, {2, 2,23},
+   {2, 2,24}, {2, 2,25}, {2, 2,26}, {2, 1,22}, {2, 1,23}, {2, 1,24}, {2, 1,25}, {2, 1,26},
+   {2, 2, 0}, {1,14, 0}, {1,15, 0}, {1,16, 0}, {1,17, 0}, {1,18, 0}, {1,19, 0}, {1,20, 0},
+   {1,21, 0}, {1,22, 0}, {1,23, 0}, {1,24, 0}, {1,25, 0}, {1,26, 0}, {1,27, 0}, {1,28, 0},
+   {1,29, 0}, {1,30, 0}, {1,31, 0}, {1,32, 0}, {1,33, 0}, {1,34, 0}, {1,35, 0}, {1,36, 0},
+   {1,37, 0}, {1,38, 0}, {1,39, 0}, {2, 2,27}, {2, 2,28}, {2, 2,29}, {2, 2,30}, {2, 2,31}
+};
+
+static const DmtxByte ctxFnc1Values[3] = { 2, DmtxValueCTXShift2, 27 };
+
+static const DmtxByte ctxX12Values[128][3] =
+{
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {1, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {1, 3, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {1, 1, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {1, 4, 0}, {1, 5, 0}, {1, 6, 0}, {1, 7, 0}, {1, 8, 0}, {1, 9, 0}, {1,10, 0}, {1,11, 0},
+   {1,12, 0}, {1,13, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {1, 2, 0}, {0, 0, 0},
+   {0, 0, 0}, {1,14, 0}, {1,15, 0}, {1,16, 0}, {1,17, 0}, {1,18, 0}, {1,19, 0}, {1,20, 0},
+   {1,21, 0}, {1,22, 0}, {1,23, 0}, {1,24, 0}, {1,25, 0}, {1,26, 0}, {1,27, 0}, {1,28, 0},
+   {1,29, 0}, {1,30, 0}, {1,31, 0}, {1,32, 0}, {1,33, 0}, {1,34, 0}, {1,35, 0}, {1,36, 0},
+   {1,37, 0}, {1,38, 0}, {1,39, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0},
+   {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}
+};
 
 /**
  *
@@ -111,7 +176,7 @@ static void
 AppendValuesCTX(DmtxEncodeStream *stream, DmtxByteList *valueList)
 {
    int pairValue;
-   DmtxByte cw0, cw1;
+   DmtxByteList *output;
 
    if(!IsCTX(stream->currentScheme))
    {
@@ -125,14 +190,20 @@ AppendValuesCTX(DmtxEncodeStream *stream, DmtxByteList *valueList)
       return;
    }
 
+   /* Both codewords are written at once, so check room for both first */
+   output = stream->output;
+   if(output->length > output->capacity - 2)
+   {
+      StreamMarkFatal(stream, DmtxErrorOutOfBounds);
+      return;
+   }
+
    /* Build codewords from computed value */
    pairValue = (1600 * valueList->b[0]) + (40 * valueList->b[1]) + valueList->b[2] + 1;
-   cw0 = pairValue / 256;
-   cw1 = pairValue % 256;
-
-   /* Append 2 codewords */
-   StreamOutputChainAppend(stream, cw0); CHKERR;
-   StreamOutputChainAppend(stream, cw1); CHKERR;
+   output->b[output->length] = (DmtxByte)(pairValue >> 8);
+   output->b[output->length + 1] = (DmtxByte)(pairValue & 0xff);
+   output->length += 2;
+   stream->outputChainWordCount += 2;
 
    /* Update count for 3 encoded values */
    stream->outputChainValueCount += 3;
@@ -426,125 +497,48 @@ static void
 PushCTXValues(DmtxByteList *valueList, DmtxByte inputValue, int targetScheme,
       DmtxPassFail *passFail, int fnc1)
 {
-   assert(valueList->length <= 2);
+   const DmtxByte *entry;
 
-   /* Handle extended ASCII with Upper Shift character */
-   if(inputValue > 127 && (fnc1 == DmtxUndefined || (int)inputValue != fnc1))
-   {
-      if(targetScheme == DmtxSchemeX12)
-      {
-         *passFail = DmtxFail;
-         return;
-      }
-      else
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift2, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, 30, passFail); RETURN_IF_FAIL;
-         inputValue -= 128;
-      }
-   }
+   /* Values are written two at a time, so leave room for 4 */
+   assert(valueList->length <= 2 && valueList->capacity - valueList->length >= 4);
 
-   /* Handle all other characters according to encodation scheme */
    if(targetScheme == DmtxSchemeX12)
    {
-      if(inputValue == 13)
-      {
-         dmtxByteListPush(valueList, 0, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue == 42)
-      {
-         dmtxByteListPush(valueList, 1, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue == 62)
-      {
-         dmtxByteListPush(valueList, 2, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue == 32)
-      {
-         dmtxByteListPush(valueList, 3, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue >= 48 && inputValue <= 57)
-      {
-         dmtxByteListPush(valueList, inputValue - 44, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue >= 65 && inputValue <= 90)
-      {
-         dmtxByteListPush(valueList, inputValue - 51, passFail); RETURN_IF_FAIL;
-      }
-      else
+      /* X12 has no shifts to reach FNC1 or extended ASCII */
+      if(inputValue > 127)
       {
          *passFail = DmtxFail;
          return;
       }
+      entry = ctxX12Values[inputValue];
+   }
+   else if(fnc1 != DmtxUndefined && (int)inputValue == fnc1)
+   {
+      entry = ctxFnc1Values;
    }
    else
    {
-      /* targetScheme is C40 or Text */
-
-      /* Check for FNC1 character */
-      if(fnc1 != DmtxUndefined && (int)inputValue == fnc1)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift2, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, 27, passFail); RETURN_IF_FAIL; /* C40 version of FNC1 */
-      }
-      else if(inputValue <= 31)
+      /* Handle extended ASCII with Upper Shift character */
+      if(inputValue > 127)
       {
-         dmtxByteListPush(valueList, DmtxValueCTXShift1, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue == 32)
-      {
-         dmtxByteListPush(valueList, 3, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 47)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift2, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue - 33, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 57)
-      {
-         dmtxByteListPush(valueList, inputValue - 44, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 64)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift2, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue - 43, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 90 && targetScheme == DmtxSchemeC40)
-      {
-         dmtxByteListPush(valueList, inputValue - 51, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 90 && targetScheme == DmtxSchemeText)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift3, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue - 64, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 95)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift2, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue - 69, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue == 96 && targetScheme == DmtxSchemeText)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift3, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, 0, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 122 && targetScheme == DmtxSchemeText)
-      {
-         dmtxByteListPush(valueList, inputValue - 83, passFail); RETURN_IF_FAIL;
-      }
-      else if(inputValue <= 127)
-      {
-         dmtxByteListPush(valueList, DmtxValueCTXShift3, passFail); RETURN_IF_FAIL;
-         dmtxByteListPush(valueList, inputValue - 96, passFail); RETURN_IF_FAIL;
-      }
-      else
-      {
-         *passFail = DmtxFail;
-         return;
+         valueList->b[valueList->length++] = DmtxValueCTXShift2;
+         valueList->b[valueList->length++] = 30;
+         inputValue -= 128;
       }
+      entry = (targetScheme == DmtxSchemeC40) ? ctxC40Values[inputValue] :
+            ctxTextValues[inputValue];
+   }
+
+   if(entry[0] == 0)
+   {
+      *passFail = DmtxFail;
+      return;
    }
 
+   valueList->b[valueList->length] = entry[1];
+   valueList->b[valueList->length + 1] = entry[2];
+   valueList->length += entry[0];
+
    *passFail = DmtxPass;
 }
 
@@ -574,19 +568,23 @@ ShiftValueListBy3(DmtxByteList *list, DmtxPassFail *passFail)
 {
    int i;
 
-   /* Shift values */
-   for(i = 0; i < list->length - 3; i++)
-      list->b[i] = list->b[i+3];
+   if(list->length == 0)
+   {
+      *passFail = DmtxFail;
+      return;
+   }
 
-   /* Shorten list by 3 (or less) */
-   for(i = 0; i < 3; i++)
+   /* Shorten list by 3 (or less) and move remaining values to front */
+   if(list->length <= 3)
    {
-      dmtxByteListPop(list, passFail);
-      if(*passFail == DmtxFail)
-         return;
+      list->length = 0;
+   }
+   else
+   {
+      for(i = 0; i < list->length - 3; i++)
+         list->b[i] = list->b[i+3];
 
-      if(list->length == 0)
-         break;
+      list->length -= 3;
    }
 
    *passFail = DmtxPass;
@@ -53,7 +53,8 @@ EncodeNextChunkEdifact(DmtxEncodeStream *stream)
 static void
 AppendValueEdifact(DmtxEncodeStream *stream, DmtxByte value)
 {
-   DmtxByte edifactValue, previousOutput;
+   int position;
+   DmtxByte edifactValue;
 
    CHKSCHEME(DmtxSchemeEdifact);
 
@@ -69,26 +70,23 @@ AppendValueEdifact(DmtxEncodeStream *stream, DmtxByte value)
    }
 
    edifactValue = (value & 0x3f) << 2;
+   position = stream->outputChainValueCount % 4;
 
-   switch(stream->outputChainValueCount % 4)
+   /* Values after the first in a quad fill the low bits of the last word */
+   if(position > 0)
    {
-      case 0:
-         StreamOutputChainAppend(stream, edifactValue); CHKERR;
-         break;
-      case 1:
-         previousOutput = StreamOutputChainRemoveLast(stream); CHKERR;
-         StreamOutputChainAppend(stream, previousOutput | (edifactValue >> 6)); CHKERR;
-         StreamOutputChainAppend(stream, edifactValue << 2); CHKERR;
-         break;
-      case 2:
-         previousOutput = StreamOutputChainRemoveLast(stream); CHKERR;
-         StreamOutputChainAppend(stream, previousOutput | (edifactValue >> 4)); CHKERR;
-         StreamOutputChainAppend(stream, edifactValue << 4); CHKERR;
-         break;
-      case 3:
-         previousOutput = StreamOutputChainRemoveLast(stream); CHKERR;
-         StreamOutputChainAppend(stream, previousOutput | (edifactValue >> 2)); CHKERR;
-         break;
+      if(stream->outputChainWordCount == 0)
+      {
+         StreamMarkFatal(stream, DmtxErrorEmptyList);
+         return;
+      }
+      stream->output->b[stream->output->length - 1] |= edifactValue >> (8 - 2 * position);
+   }
+
+   /* Remaining bits start the next word, except for the last value of a quad */
+   if(position < 3)
+   {
+      StreamOutputChainAppend(stream, (DmtxByte)(edifactValue << (2 * position))); CHKERR;
    }
 
    stream->outputChainValueCount++;
@@ -16,43 +16,23 @@
 
 #define DUMPSTREAMS 0
 
-enum SchemeState {
-   AsciiFull,
-   AsciiCompactOffset0, /* 0 offset from first regular input value */
-   AsciiCompactOffset1,
-   C40Offset0,          /* 0 offset from first expanded C40 value */
-   C40Offset1,
-   C40Offset2,
-   TextOffset0,         /* 0 offset from first expanded Text value */
-   TextOffset1,
-   TextOffset2,
-   X12Offset0,          /* 0 offset from first expanded X12 value */
-   X12Offset1,
-   X12Offset2,
-   EdifactOffset0,      /* 0 offset from first regular input value */
-   EdifactOffset1,
-   EdifactOffset2,
-   EdifactOffset3,
-   Base256,
-   SchemeStateCount
-};
-
 #if DUMPSTREAMS
-static void DumpStreams(DmtxEncodeStream *streamBest)
+static void DumpStreams(DmtxEncodeState *statesBest)
 {
    enum SchemeState state;
+   DmtxEncodeStream *stream;
    char prefix[32];
 
    fprintf(stdout, "----------------------------------------\n");
    for(state = 0; state < SchemeStateCount; state++)
    {
-      if(streamBest[state].status == DmtxStatusEncoding ||
-            streamBest[state].status == DmtxStatusComplete)
-         fprintf(stdout, "\"%c\" ", streamBest[state].input->b[streamBest[state].inputNext-1]);
+      stream = &(statesBest[state].stream);
+      if(stream->status == DmtxStatusEncoding || stream->status == DmtxStatusComplete)
+         fprintf(stdout, "\"%c\" ", stream->input->b[stream->inputNext-1]);
       else
          fprintf(stdout, "    ");
 
-      switch(streamBest[state].status) {
+      switch(stream->status) {
          case DmtxStatusEncoding:
             snprintf(prefix, sizeof(prefix), "%2d (%s): ", state, " encode ");
             break;
@@ -66,119 +46,580 @@ static void DumpStreams(DmtxEncodeStream *streamBest)
             snprintf(prefix, sizeof(prefix), "%2d (%s): ", state, " fatal  ");
             break;
       }
-      dmtxByteListPrint(streamBest[state].output, prefix);
+      fprintf(stdout, "%s%d words\n", prefix, stream->output->length);
    }
 }
 #endif
 
+/**
+ * The search below only ever compares output lengths, and no encoding
+ * decision depends on the value of a word already written. Each state
+ * therefore tracks the stream's scalar progress and output length while its
+ * words go to a shared scratch buffer. Every chunk encoded into a state is
+ * recorded as a step linked to the step it continued from, and once the
+ * winner is known its chain of steps is encoded again into real output.
+ * Memory grows with one step per state per input word rather than one full
+ * output buffer per state, and no state is copied word by word.
+ */
 
 /**
- *
- *
+ * The search only ever looks a few words past the furthest chunk it has
+ * encoded, except where a chunk runs into the end of input. A label prefix
+ * can therefore be searched once up to the point where some chunk came
+ * within DmtxEncodeLookahead words of the prefix end, and every label that
+ * starts with it resumes from there. Steps recorded so far are kept with the
+ * paused search, so the winner is still replayed from the first input word.
+ */
+
+/**
+ * \brief  Find the shortest encodation over all scheme combinations
+ * \param  input
+ * \param  output Receives winning data codewords, or NULL to only find the
+ *         symbol size (no steps are recorded and nothing is allocated)
+ * \param  sizeIdxRequest
+ * \param  fnc1
+ * \param  padCount Receives number of pad words following the message
+ * \return Symbol size, or DmtxUndefined if input can't be encoded
  */
 static int
-EncodeOptimizeBest(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1)
+EncodeOptimizeBest(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount)
 {
-   enum SchemeState state;
-   int inputNext, c40ValueCount, textValueCount, x12ValueCount;
    int sizeIdx;
-   DmtxEncodeStream *winner;
-   DmtxPassFail passFail;
-   DmtxEncodeStream streamsBest[SchemeStateCount];
-   DmtxEncodeStream streamsTemp[SchemeStateCount];
-   DmtxByte outputsBestStorage[SchemeStateCount][4096];
-   DmtxByte outputsTempStorage[SchemeStateCount][4096];
-   DmtxByte ctxTempStorage[4];
-   DmtxByteList outputsBest[SchemeStateCount];
-   DmtxByteList outputsTemp[SchemeStateCount];
-   DmtxByteList ctxTemp = dmtxByteListBuild(ctxTempStorage, sizeof(ctxTempStorage));
+   DmtxEncodeSearch search;
+   DmtxEncodeTrail trail;
+   DmtxInputRun runStorage[DmtxEncodeInputMax];
+   DmtxByte scratchStorage[4096];
 
-   /* Initialize all streams with their own output storage */
-   for(state = 0; state < SchemeStateCount; state++)
+   /* No scheme fits more than this in the largest symbol */
+   if(input->length > DmtxEncodeInputMax)
+      return DmtxUndefined;
+
+   /* Each input word adds at most one step per state */
+   trail.count = 0;
+   trail.capacity = 0;
+   trail.step = NULL;
+   trail.run = runStorage;
+   trail.reach = 0;
+
+   if(output != NULL)
    {
-      outputsBest[state] = dmtxByteListBuild(outputsBestStorage[state], sizeof(outputsBestStorage[state]));
-      outputsTemp[state] = dmtxByteListBuild(outputsTempStorage[state], sizeof(outputsTempStorage[state]));
-      streamsBest[state] = StreamInit(input, &(outputsBest[state]));
-      streamsTemp[state] = StreamInit(input, &(outputsTemp[state]));
-      streamsBest[state].fnc1 = fnc1;
-      streamsTemp[state].fnc1 = fnc1;
+      trail.capacity = input->length * SchemeStateCount;
+      trail.step = (DmtxEncodeStep *)malloc(trail.capacity * sizeof(DmtxEncodeStep));
+      if(trail.step == NULL)
+         return DmtxUndefined;
    }
 
-   c40ValueCount = textValueCount = x12ValueCount = 0;
+   ClassifyInputRuns(trail.run, input, fnc1);
 
-   for(inputNext = 0; inputNext < input->length; inputNext++)
-   {
-      StreamAdvanceFromBest(streamsTemp, streamsBest, AsciiFull, sizeIdxRequest);
+   /* Scratch words are never inspected, but keep them defined */
+   memset(scratchStorage, 0x00, sizeof(scratchStorage));
+
+   EncodeSearchInit(&search, input, scratchStorage, sizeof(scratchStorage), fnc1);
+
+   sizeIdx = EncodeSearchFinish(&search, &trail, input, output, sizeIdxRequest, fnc1, padCount);
+
+   if(trail.step != NULL)
+      free(trail.step);
 
-      AdvanceAsciiCompact(streamsTemp, streamsBest, AsciiCompactOffset0, inputNext, sizeIdxRequest);
-      AdvanceAsciiCompact(streamsTemp, streamsBest, AsciiCompactOffset1, inputNext, sizeIdxRequest);
+   return sizeIdx;
+}
+
+/**
+ * \brief  Find the shortest encodation of a message that starts with a
+ *         prefix, resuming the search paused by EncodeOptimizePrefix()
+ * \param  prefix
+ * \param  input Whole message, prefix words included
+ * \param  output Receives winning data codewords
+ * \param  padCount Receives number of pad words following the message
+ * \return Symbol size, or DmtxUndefined if input can't be encoded
+ */
+static int
+EncodeOptimizeBestPrefixed(DmtxEncodePrefix *prefix, DmtxByteList *input, DmtxByteList *output, int *padCount)
+{
+   int sizeIdx;
+   DmtxEncodeSearch search;
+   DmtxEncodeTrail trail;
+   DmtxInputRun runStorage[DmtxEncodeInputMax];
+   DmtxByte scratchStorage[4096];
 
-      AdvanceCTX(streamsTemp, streamsBest, C40Offset0, inputNext, c40ValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, C40Offset1, inputNext, c40ValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, C40Offset2, inputNext, c40ValueCount, sizeIdxRequest);
+   if(input->length > DmtxEncodeInputMax || input->length < prefix->length)
+      return DmtxUndefined;
 
-      AdvanceCTX(streamsTemp, streamsBest, TextOffset0, inputNext, textValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, TextOffset1, inputNext, textValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, TextOffset2, inputNext, textValueCount, sizeIdxRequest);
+   /* Prefix steps keep their positions so state links stay valid */
+   trail.count = prefix->stepCount;
+   trail.capacity = prefix->stepCount +
+         (input->length - prefix->search.inputNext) * SchemeStateCount;
+   trail.step = (DmtxEncodeStep *)malloc(trail.capacity * sizeof(DmtxEncodeStep));
+   trail.run = runStorage;
+   trail.reach = 0;
+   if(trail.step == NULL)
+      return DmtxUndefined;
 
-      AdvanceCTX(streamsTemp, streamsBest, X12Offset0, inputNext, x12ValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, X12Offset1, inputNext, x12ValueCount, sizeIdxRequest);
-      AdvanceCTX(streamsTemp, streamsBest, X12Offset2, inputNext, x12ValueCount, sizeIdxRequest);
+   memcpy(trail.step, prefix->step, prefix->stepCount * sizeof(DmtxEncodeStep));
 
-      AdvanceEdifact(streamsTemp, streamsBest, EdifactOffset0, inputNext, sizeIdxRequest);
-      AdvanceEdifact(streamsTemp, streamsBest, EdifactOffset1, inputNext, sizeIdxRequest);
-      AdvanceEdifact(streamsTemp, streamsBest, EdifactOffset2, inputNext, sizeIdxRequest);
-      AdvanceEdifact(streamsTemp, streamsBest, EdifactOffset3, inputNext, sizeIdxRequest);
+   /* Runs near the prefix end depend on the suffix, so classify it all */
+   ClassifyInputRuns(trail.run, input, prefix->fnc1);
 
-      StreamAdvanceFromBest(streamsTemp, streamsBest, Base256, sizeIdxRequest);
+   memset(scratchStorage, 0x00, sizeof(scratchStorage));
 
-      /* Overwrite best streams with new results */
-      for(state = 0; state < SchemeStateCount; state++)
+   search = prefix->search;
+   EncodeSearchRebind(&search, input, scratchStorage, sizeof(scratchStorage));
+
+   sizeIdx = EncodeSearchFinish(&search, &trail, input, output,
+         prefix->sizeIdxRequest, prefix->fnc1, padCount);
+
+   free(trail.step);
+
+   return sizeIdx;
+}
+
+/**
+ * \brief  Search prefix words until the suffix could start to matter, and
+ *         keep the paused search and its steps in the prefix
+ * \param  prefix Holds prefix words, size request, and FNC1 setting
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+EncodeOptimizePrefix(DmtxEncodePrefix *prefix)
+{
+   int stepCount;
+   DmtxByteList input = dmtxByteListBuild(prefix->b, prefix->length);
+   DmtxEncodeSearch searchPrev;
+   DmtxEncodeTrail trail;
+   DmtxInputRun runStorage[DmtxEncodeInputMax];
+   DmtxByte scratchStorage[4096];
+
+   input.length = prefix->length;
+
+   if(input.length <= 0 || input.length > DmtxEncodeInputMax)
+      return DmtxFail;
+
+   trail.count = 0;
+   trail.capacity = input.length * SchemeStateCount;
+   trail.step = (DmtxEncodeStep *)malloc(trail.capacity * sizeof(DmtxEncodeStep));
+   trail.run = runStorage;
+   trail.reach = 0;
+   if(trail.step == NULL)
+      return DmtxFail;
+
+   ClassifyInputRuns(trail.run, &input, prefix->fnc1);
+
+   memset(scratchStorage, 0x00, sizeof(scratchStorage));
+
+   EncodeSearchInit(&(prefix->search), &input, scratchStorage, sizeof(scratchStorage), prefix->fnc1);
+
+   /*
+    * Never advance over the last words, so no chunk completes on the cut-off
+    * prefix, and back out of the first input word whose chunks read close
+    * to the end anyway
+    */
+   while(prefix->search.inputNext + DmtxEncodeLookahead < input.length)
+   {
+      searchPrev = prefix->search;
+      stepCount = trail.count;
+
+      EncodeSearchAdvance(&(prefix->search), prefix->sizeIdxRequest, &trail);
+
+      if(trail.reach + DmtxEncodeLookahead > input.length)
       {
-         if(streamsBest[state].status != DmtxStatusComplete)
-            StreamCopy(&(streamsBest[state]), &(streamsTemp[state]));
+         prefix->search = searchPrev;
+         trail.count = stepCount;
+         break;
       }
+   }
 
-      dmtxByteListClear(&ctxTemp);
-      PushCTXValues(&ctxTemp, input->b[inputNext], DmtxSchemeC40, &passFail, fnc1);
-      c40ValueCount += ((passFail == DmtxPass) ? ctxTemp.length : 1);
+   prefix->step = trail.step;
+   prefix->stepCount = trail.count;
 
-      dmtxByteListClear(&ctxTemp);
-      PushCTXValues(&ctxTemp, input->b[inputNext], DmtxSchemeText, &passFail, fnc1);
-      textValueCount += ((passFail == DmtxPass) ? ctxTemp.length : 1);
+   return DmtxPass;
+}
 
-      dmtxByteListClear(&ctxTemp);
-      PushCTXValues(&ctxTemp, input->b[inputNext], DmtxSchemeX12, &passFail, fnc1);
-      x12ValueCount += ((passFail == DmtxPass) ? ctxTemp.length : 1);
+/**
+ * \brief  Advance search over remaining input, then choose the winner and
+ *         encode its steps
+ * \param  search
+ * \param  trail
+ * \param  input
+ * \param  output Receives winning data codewords, or NULL for size only
+ * \param  sizeIdxRequest
+ * \param  fnc1
+ * \param  padCount Receives number of pad words following the message
+ * \return Symbol size, or DmtxUndefined if input can't be encoded
+ */
+static int
+EncodeSearchFinish(DmtxEncodeSearch *search, DmtxEncodeTrail *trail, DmtxByteList *input,
+      DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount)
+{
+   enum SchemeState state;
+   DmtxEncodeState *winner;
 
-#if DUMPSTREAMS
-      DumpStreams(streamsBest);
-#endif
-   }
+   while(search->inputNext < input->length)
+      EncodeSearchAdvance(search, sizeIdxRequest, trail);
 
    /* Choose the overall winner */
    winner = NULL;
    for(state = 0; state < SchemeStateCount; state++)
    {
-      if(streamsBest[state].status == DmtxStatusComplete)
+      if(search->statesBest[state].stream.status == DmtxStatusComplete)
       {
-         if(winner == NULL || streamsBest[state].output->length < winner->output->length)
-            winner = &(streamsBest[state]);
+         if(winner == NULL || search->statesBest[state].output.length < winner->output.length)
+            winner = &(search->statesBest[state]);
       }
    }
 
-   /* Copy winner to output */
+   /* Encode winning steps to output */
    if(winner == NULL)
+      return DmtxUndefined;
+
+   *padCount = winner->stream.padCount;
+   if(output == NULL)
+      return winner->stream.sizeIdx;
+
+   return EncodeTrailReplay(trail, winner->step, input, output, sizeIdxRequest, fnc1);
+}
+
+/**
+ * \brief  Prepare every search state at start of input
+ * \param  search
+ * \param  input
+ * \param  scratch Storage shared by all states
+ * \param  capacity Size of scratch storage
+ * \param  fnc1
+ * \return void
+ */
+static void
+EncodeSearchInit(DmtxEncodeSearch *search, DmtxByteList *input, DmtxByte *scratch, int capacity, int fnc1)
+{
+   enum SchemeState state;
+
+   /* Initialize all states on the shared scratch storage */
+   for(state = 0; state < SchemeStateCount; state++)
    {
-      sizeIdx = DmtxUndefined;
+      EncodeStateInit(&(search->statesBest[state]), input, scratch, capacity, fnc1);
+      EncodeStateInit(&(search->statesTemp[state]), input, scratch, capacity, fnc1);
    }
-   else
+
+   search->inputNext = 0;
+   search->c40ValueCount = search->textValueCount = search->x12ValueCount = 0;
+}
+
+/**
+ * \brief  Point a copied search at new input and scratch storage. Output
+ *         lengths carry over, since scratch words are never inspected.
+ * \param  search
+ * \param  input
+ * \param  scratch Storage shared by all states
+ * \param  capacity Size of scratch storage
+ * \return void
+ */
+static void
+EncodeSearchRebind(DmtxEncodeSearch *search, DmtxByteList *input, DmtxByte *scratch, int capacity)
+{
+   enum SchemeState state;
+   DmtxEncodeState *states[2];
+   int i;
+
+   states[0] = search->statesBest;
+   states[1] = search->statesTemp;
+
+   for(i = 0; i < 2; i++)
    {
-      dmtxByteListCopy(output, winner->output, &passFail);
-      sizeIdx = (passFail == DmtxPass) ? winner->sizeIdx : DmtxUndefined;
+      for(state = 0; state < SchemeStateCount; state++)
+      {
+         states[i][state].output.b = scratch;
+         states[i][state].output.capacity = capacity;
+         states[i][state].stream.output = &(states[i][state].output);
+         states[i][state].stream.input = input;
+      }
    }
+}
 
-   return sizeIdx;
+/**
+ * \brief  Advance all states over the next input word
+ * \param  search
+ * \param  sizeIdxRequest
+ * \param  trail
+ * \return void
+ */
+static void
+EncodeSearchAdvance(DmtxEncodeSearch *search, int sizeIdxRequest, DmtxEncodeTrail *trail)
+{
+   enum SchemeState state;
+   int inputNext = search->inputNext;
+   DmtxEncodeState *statesBest = search->statesBest;
+   DmtxEncodeState *statesTemp = search->statesTemp;
+
+   StreamAdvanceFromBest(statesTemp, statesBest, AsciiFull, sizeIdxRequest, trail);
+
+   AdvanceAsciiCompact(statesTemp, statesBest, AsciiCompactOffset0, inputNext, sizeIdxRequest, trail);
+   AdvanceAsciiCompact(statesTemp, statesBest, AsciiCompactOffset1, inputNext, sizeIdxRequest, trail);
+
+   AdvanceCTX(statesTemp, statesBest, C40Offset0, inputNext, search->c40ValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, C40Offset1, inputNext, search->c40ValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, C40Offset2, inputNext, search->c40ValueCount, sizeIdxRequest, trail);
+
+   AdvanceCTX(statesTemp, statesBest, TextOffset0, inputNext, search->textValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, TextOffset1, inputNext, search->textValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, TextOffset2, inputNext, search->textValueCount, sizeIdxRequest, trail);
+
+   AdvanceCTX(statesTemp, statesBest, X12Offset0, inputNext, search->x12ValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, X12Offset1, inputNext, search->x12ValueCount, sizeIdxRequest, trail);
+   AdvanceCTX(statesTemp, statesBest, X12Offset2, inputNext, search->x12ValueCount, sizeIdxRequest, trail);
+
+   AdvanceEdifact(statesTemp, statesBest, EdifactOffset0, inputNext, sizeIdxRequest, trail);
+   AdvanceEdifact(statesTemp, statesBest, EdifactOffset1, inputNext, sizeIdxRequest, trail);
+   AdvanceEdifact(statesTemp, statesBest, EdifactOffset2, inputNext, sizeIdxRequest, trail);
+   AdvanceEdifact(statesTemp, statesBest, EdifactOffset3, inputNext, sizeIdxRequest, trail);
+
+   StreamAdvanceFromBest(statesTemp, statesBest, Base256, sizeIdxRequest, trail);
+
+   /* Overwrite best states with new results */
+   for(state = 0; state < SchemeStateCount; state++)
+   {
+      if(statesBest[state].stream.status != DmtxStatusComplete)
+         EncodeStateCopy(&(statesBest[state]), &(statesTemp[state]));
+   }
+
+   search->c40ValueCount += trail->run[inputNext].c40Count;
+   search->textValueCount += trail->run[inputNext].textCount;
+   search->x12ValueCount += trail->run[inputNext].x12Count;
+   search->inputNext++;
+
+#if DUMPSTREAMS
+   DumpStreams(statesBest);
+#endif
+}
+
+/**
+ * \brief  Prepare search state at start of input
+ * \param  state
+ * \param  input
+ * \param  scratch Storage shared by all states
+ * \param  capacity Size of scratch storage
+ * \param  fnc1
+ * \return void
+ */
+static void
+EncodeStateInit(DmtxEncodeState *state, DmtxByteList *input, DmtxByte *scratch, int capacity, int fnc1)
+{
+   state->output = dmtxByteListBuild(scratch, capacity);
+   state->stream = StreamInit(input, &(state->output));
+   state->stream.fnc1 = fnc1;
+   state->step = DmtxUndefined;
+}
+
+/**
+ * \brief  Copy search state without touching output words
+ * \param  dst
+ * \param  src
+ * \return void
+ */
+static void
+EncodeStateCopy(DmtxEncodeState *dst, DmtxEncodeState *src)
+{
+   dst->stream = src->stream;
+   dst->stream.output = &(dst->output);
+   dst->output = src->output;
+   dst->step = src->step;
+}
+
+/**
+ * \brief  Record chunk encoded into a state
+ * \param  trail
+ * \param  state State that just encoded the chunk
+ * \param  scheme
+ * \param  option
+ * \return void
+ */
+static void
+EncodeTrailPush(DmtxEncodeTrail *trail, DmtxEncodeState *state, int scheme, int option)
+{
+   DmtxEncodeStep *step;
+
+   /* Size-only searches don't keep a trail */
+   if(trail->step == NULL)
+      return;
+
+   assert(trail->count < trail->capacity);
+
+   step = &(trail->step[trail->count]);
+   step->prev = state->step;
+   step->scheme = scheme;
+   step->option = option;
+
+   state->step = trail->count++;
+}
+
+/**
+ * \brief  Note how far into input a chunk encoded into a state has read
+ * \param  trail
+ * \param  state State that just encoded the chunk
+ * \return void
+ */
+static void
+EncodeTrailReach(DmtxEncodeTrail *trail, DmtxEncodeState *state)
+{
+   if(state->stream.inputNext > trail->reach)
+      trail->reach = state->stream.inputNext;
+}
+
+/**
+ * \brief  Encode a winning chain of steps again into real output storage
+ * \param  trail
+ * \param  last Final step of winning state
+ * \param  input
+ * \param  output
+ * \param  sizeIdxRequest
+ * \param  fnc1
+ * \return Symbol size of completed stream, or DmtxUndefined
+ */
+static int
+EncodeTrailReplay(DmtxEncodeTrail *trail, int last, DmtxByteList *input,
+      DmtxByteList *output, int sizeIdxRequest, int fnc1)
+{
+   int idx, prev, first;
+   DmtxEncodeStream stream;
+
+   /* Steps are linked last to first, so reverse the links in place */
+   first = DmtxUndefined;
+   for(idx = last; idx != DmtxUndefined; idx = prev)
+   {
+      prev = trail->step[idx].prev;
+      trail->step[idx].prev = first;
+      first = idx;
+   }
+
+   dmtxByteListClear(output);
+   stream = StreamInit(input, output);
+   stream.fnc1 = fnc1;
+
+   for(idx = first; idx != DmtxUndefined && stream.status == DmtxStatusEncoding;
+         idx = trail->step[idx].prev)
+   {
+      EncodeNextChunk(&stream, trail->step[idx].scheme, trail->step[idx].option, sizeIdxRequest);
+   }
+
+   return (stream.status == DmtxStatusComplete) ? stream.sizeIdx : DmtxUndefined;
+}
+
+/**
+ * \brief  Classify input once before the search. Run lengths count how many
+ *         words from each position can be written as ASCII digits, X12, and
+ *         EDIFACT, and value counts give how many C40, Text, and X12 values
+ *         each word expands to (an unsupported word counts as one).
+ * \param  run One entry per input word
+ * \param  input
+ * \param  fnc1
+ * \return void
+ */
+static void
+ClassifyInputRuns(DmtxInputRun *run, DmtxByteList *input, int fnc1)
+{
+   int i, value, scheme;
+   DmtxPassFail passFail;
+   DmtxByte valueCount[3][256];
+   DmtxByte ctxTempStorage[4];
+   DmtxByteList ctxTemp = dmtxByteListBuild(ctxTempStorage, sizeof(ctxTempStorage));
+   DmtxScheme ctxScheme[3] = { DmtxSchemeC40, DmtxSchemeText, DmtxSchemeX12 };
+
+   /* Expand each distinct value only once, on first use */
+   memset(valueCount, 0x00, sizeof(valueCount));
+
+   /* Walk backward so each run extends the one after it */
+   for(i = input->length - 1; i >= 0; i--)
+   {
+      value = input->b[i];
+
+      if(valueCount[0][value] == 0)
+      {
+         for(scheme = 0; scheme < 3; scheme++)
+         {
+            dmtxByteListClear(&ctxTemp);
+            PushCTXValues(&ctxTemp, value, ctxScheme[scheme], &passFail, fnc1);
+            valueCount[scheme][value] = (passFail == DmtxPass) ? ctxTemp.length : 1;
+         }
+      }
+
+      run[i].c40Count = valueCount[0][value];
+      run[i].textCount = valueCount[1][value];
+      run[i].x12Count = valueCount[2][value];
+
+      run[i].digitRun = 0;
+      run[i].x12Run = 0;
+      run[i].edifactRun = 0;
+
+      if(ISDIGIT(value))
+         run[i].digitRun = 1;
+
+      /* FNC1 ends an X12 run because X12 sends it in ASCII */
+      if((value == 13 || value == 42 || value == 62 || value == 32 || ISDIGIT(value) ||
+            (value >= 'A' && value <= 'Z')) && value != fnc1)
+         run[i].x12Run = 1;
+
+      if(value >= 32 && value <= 94)
+         run[i].edifactRun = 1;
+
+      /* Saturate so long runs never read as short ones */
+      if(i + 1 < input->length)
+      {
+         if(run[i].digitRun > 0)
+            run[i].digitRun = (run[i + 1].digitRun < 255) ? run[i + 1].digitRun + 1 : 255;
+
+         if(run[i].x12Run > 0)
+            run[i].x12Run = (run[i + 1].x12Run < 255) ? run[i + 1].x12Run + 1 : 255;
+
+         if(run[i].edifactRun > 0)
+            run[i].edifactRun = (run[i + 1].edifactRun < 255) ? run[i + 1].edifactRun + 1 : 255;
+      }
+   }
+}
+
+/**
+ * \brief  Tell whether a chunk in the target state is sure to leave the
+ *         stream invalid. Only cases that can't reach an end-of-symbol
+ *         shortcut are reported, so skipping them never changes the result.
+ * \param  from State the chunk would continue from
+ * \param  targetState
+ * \param  run Input classification
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+ChunkCantEncode(DmtxEncodeState *from, int targetState, DmtxInputRun *run)
+{
+   int inputNext, remaining, x12Run;
+   DmtxEncodeStream *stream = &(from->stream);
+
+   inputNext = stream->inputNext;
+   remaining = stream->input->length - inputNext;
+
+   switch(targetState)
+   {
+      case AsciiCompactOffset0:
+      case AsciiCompactOffset1:
+         return (run[inputNext].digitRun < 2) ? DmtxTrue : DmtxFalse;
+
+      case X12Offset0:
+      case X12Offset1:
+      case X12Offset2:
+         /* A short run ended by FNC1 is still valid, as it unlatches */
+         x12Run = run[inputNext].x12Run;
+         if(remaining >= 6 && x12Run < 3 && stream->input->b[inputNext + x12Run] != stream->fnc1)
+            return DmtxTrue;
+         break;
+
+      case EdifactOffset0:
+      case EdifactOffset1:
+      case EdifactOffset2:
+      case EdifactOffset3:
+         if(remaining >= 6 && run[inputNext].edifactRun == 0)
+            return DmtxTrue;
+         break;
+
+      default:
+         break;
+   }
+
+   return DmtxFalse;
 }
 
 /**
@@ -187,18 +628,16 @@ EncodeOptimizeBest(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest
  * is the number of latches/unlatches that are also encoded
  */
 static void
-StreamAdvanceFromBest(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
-     int targetState, int sizeIdxRequest)
+StreamAdvanceFromBest(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+     int targetState, int sizeIdxRequest, DmtxEncodeTrail *trail)
 {
    enum SchemeState fromState;
    DmtxScheme targetScheme;
    DmtxEncodeOption encodeOption;
-   DmtxByte outputTempStorage[4096];
-   DmtxByteList outputTemp = dmtxByteListBuild(outputTempStorage, sizeof(outputTempStorage));
-   DmtxEncodeStream streamTemp;
-   DmtxEncodeStream *targetStream = &(streamsNext[targetState]);
+   DmtxBoolean advanced;
+   DmtxEncodeState stateTemp;
+   DmtxEncodeState *target = &(statesNext[targetState]);
 
-   streamTemp.output = &outputTemp; /* Set directly instead of calling StreamInit() */
    targetScheme = GetScheme(targetState);
 
    if(targetState == AsciiFull)
@@ -208,34 +647,47 @@ StreamAdvanceFromBest(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBe
    else
       encodeOption = DmtxEncodeNormal;
 
+   advanced = DmtxFalse;
    for(fromState = 0; fromState < SchemeStateCount; fromState++)
    {
-      if(streamsBest[fromState].status != DmtxStatusEncoding ||
+      if(statesBest[fromState].stream.status != DmtxStatusEncoding ||
             ValidStateSwitch(fromState, targetState) == DmtxFalse)
       {
          continue;
       }
 
-      StreamCopy(&streamTemp, &(streamsBest[fromState]));
-      EncodeNextChunk(&streamTemp, targetScheme, encodeOption, sizeIdxRequest);
+      /* Invalid results only matter when continuing from ASCII */
+      if(fromState != 0 && ChunkCantEncode(&(statesBest[fromState]), targetState,
+            trail->run) == DmtxTrue)
+      {
+         continue;
+      }
+
+      EncodeStateCopy(&stateTemp, &(statesBest[fromState]));
+      EncodeNextChunk(&(stateTemp.stream), targetScheme, encodeOption, sizeIdxRequest);
+      EncodeTrailReach(trail, &stateTemp);
 
-      if(fromState == 0 || (streamTemp.status != DmtxStatusInvalid &&
-            streamTemp.output->length < targetStream->output->length))
+      if(fromState == 0 || (stateTemp.stream.status != DmtxStatusInvalid &&
+            stateTemp.output.length < target->output.length))
       {
-         StreamCopy(targetStream, &streamTemp);
+         EncodeStateCopy(target, &stateTemp);
+         advanced = DmtxTrue;
       }
    }
+
+   if(advanced == DmtxTrue)
+      EncodeTrailPush(trail, target, targetScheme, encodeOption);
 }
 
 /**
  *
  */
 static void
-AdvanceAsciiCompact(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
-      int targetState, int inputNext, int sizeIdxRequest)
+AdvanceAsciiCompact(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int targetState, int inputNext, int sizeIdxRequest, DmtxEncodeTrail *trail)
 {
-   DmtxEncodeStream *currentStream = &(streamsBest[targetState]);
-   DmtxEncodeStream *targetStream = &(streamsNext[targetState]);
+   DmtxEncodeState *current = &(statesBest[targetState]);
+   DmtxEncodeState *target = &(statesNext[targetState]);
    DmtxBoolean isStartState;
 
    switch(targetState)
@@ -249,22 +701,22 @@ AdvanceAsciiCompact(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest
          break;
 
       default:
-         StreamMarkFatal(targetStream, DmtxErrorIllegalParameterValue);
+         StreamMarkFatal(&(target->stream), DmtxErrorIllegalParameterValue);
          return;
    }
 
-   if(inputNext < currentStream->inputNext)
+   if(inputNext < current->stream.inputNext)
    {
-      StreamCopy(targetStream, currentStream);
+      EncodeStateCopy(target, current);
    }
    else if(isStartState == DmtxTrue)
    {
-      StreamAdvanceFromBest(streamsNext, streamsBest, targetState, sizeIdxRequest);
+      StreamAdvanceFromBest(statesNext, statesBest, targetState, sizeIdxRequest, trail);
    }
    else
    {
-      StreamCopy(targetStream, currentStream);
-      StreamMarkInvalid(targetStream, DmtxErrorUnknown);
+      EncodeStateCopy(target, current);
+      StreamMarkInvalid(&(target->stream), DmtxErrorUnknown);
    }
 }
 
@@ -272,11 +724,11 @@ AdvanceAsciiCompact(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest
  *
  */
 static void
-AdvanceCTX(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
-      int targetState, int inputNext, int ctxValueCount, int sizeIdxRequest)
+AdvanceCTX(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int targetState, int inputNext, int ctxValueCount, int sizeIdxRequest, DmtxEncodeTrail *trail)
 {
-   DmtxEncodeStream *currentStream = &(streamsBest[targetState]);
-   DmtxEncodeStream *targetStream = &(streamsNext[targetState]);
+   DmtxEncodeState *current = &(statesBest[targetState]);
+   DmtxEncodeState *target = &(statesNext[targetState]);
    DmtxBoolean isStartState;
 
    /* we won't actually use inputNext here */
@@ -301,22 +753,22 @@ AdvanceCTX(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
          break;
 
       default:
-         StreamMarkFatal(targetStream, DmtxErrorIllegalParameterValue);
+         StreamMarkFatal(&(target->stream), DmtxErrorIllegalParameterValue);
          return;
    }
 
-   if(inputNext < currentStream->inputNext)
+   if(inputNext < current->stream.inputNext)
    {
-      StreamCopy(targetStream, currentStream);
+      EncodeStateCopy(target, current);
    }
    else if(isStartState == DmtxTrue)
    {
-      StreamAdvanceFromBest(streamsNext, streamsBest, targetState, sizeIdxRequest);
+      StreamAdvanceFromBest(statesNext, statesBest, targetState, sizeIdxRequest, trail);
    }
    else
    {
-      StreamCopy(targetStream, currentStream);
-      StreamMarkInvalid(targetStream, DmtxErrorUnknown);
+      EncodeStateCopy(target, current);
+      StreamMarkInvalid(&(target->stream), DmtxErrorUnknown);
    }
 }
 
@@ -324,11 +776,11 @@ AdvanceCTX(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
  *
  */
 static void
-AdvanceEdifact(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
-      int targetState, int inputNext, int sizeIdxRequest)
+AdvanceEdifact(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int targetState, int inputNext, int sizeIdxRequest, DmtxEncodeTrail *trail)
 {
-   DmtxEncodeStream *currentStream = &(streamsBest[targetState]);
-   DmtxEncodeStream *targetStream = &(streamsNext[targetState]);
+   DmtxEncodeState *current = &(statesBest[targetState]);
+   DmtxEncodeState *target = &(statesNext[targetState]);
    DmtxBoolean isStartState;
 
    switch(targetState)
@@ -350,21 +802,27 @@ AdvanceEdifact(DmtxEncodeStream *streamsNext, DmtxEncodeStream *streamsBest,
          break;
 
       default:
-         StreamMarkFatal(targetStream, DmtxErrorIllegalParameterValue);
+         StreamMarkFatal(&(target->stream), DmtxErrorIllegalParameterValue);
          return;
    }
 
    if(isStartState == DmtxTrue)
    {
-      StreamAdvanceFromBest(streamsNext, streamsBest, targetState, sizeIdxRequest);
+      StreamAdvanceFromBest(statesNext, statesBest, targetState, sizeIdxRequest, trail);
    }
    else
    {
-      StreamCopy(targetStream, currentStream);
-      if(currentStream->status == DmtxStatusEncoding && currentStream->currentScheme == DmtxSchemeEdifact)
-         EncodeNextChunk(targetStream, DmtxSchemeEdifact, DmtxEncodeNormal, sizeIdxRequest);
+      EncodeStateCopy(target, current);
+      if(current->stream.status == DmtxStatusEncoding && current->stream.currentScheme == DmtxSchemeEdifact)
+      {
+         EncodeNextChunk(&(target->stream), DmtxSchemeEdifact, DmtxEncodeNormal, sizeIdxRequest);
+         EncodeTrailReach(trail, target);
+         EncodeTrailPush(trail, target, DmtxSchemeEdifact, DmtxEncodeNormal);
+      }
       else
-         StreamMarkInvalid(targetStream, DmtxErrorUnknown);
+      {
+         StreamMarkInvalid(&(target->stream), DmtxErrorUnknown);
+      }
    }
 }
 
@@ -439,3 +897,280 @@ ValidStateSwitch(int fromState, int targetState)
 
    return validStateSwitch;
 }
+
+/**
+ * \brief  Encode input in a single pass, choosing each scheme change with the
+ *         look-ahead test of ISO/IEC 16022 Annex P. Decisions are never
+ *         revisited, so output may be a few codewords longer than what
+ *         EncodeOptimizeBest() finds.
+ * \param  input
+ * \param  output
+ * \param  sizeIdxRequest
+ * \param  fnc1
+ * \param  padCount Receives number of pad words following the message
+ * \return Symbol size of completed stream, or DmtxUndefined
+ */
+static int
+EncodeAutoFast(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount)
+{
+   DmtxEncodeStream stream;
+
+   stream = StreamInit(input, output);
+   stream.fnc1 = fnc1;
+
+   while(stream.status == DmtxStatusEncoding)
+      EncodeNextChunk(&stream, NextSchemeFast(&stream), DmtxEncodeNormal, sizeIdxRequest);
+
+   if(stream.status != DmtxStatusComplete || StreamInputHasNext(&stream))
+      return DmtxUndefined;
+
+   *padCount = stream.padCount;
+
+   return stream.sizeIdx;
+}
+
+/**
+ * \brief  Decide scheme for the next chunk. The look-ahead test only runs
+ *         where the current scheme can be left cleanly: before every input
+ *         in ASCII and Base 256, after each full triplet in C40/Text/X12, and
+ *         after each full quad in EDIFACT.
+ * \param  stream
+ * \return Scheme to encode next chunk in
+ */
+static DmtxScheme
+NextSchemeFast(DmtxEncodeStream *stream)
+{
+   int i, count, value;
+   DmtxScheme scheme;
+   DmtxByte *next;
+
+   scheme = stream->currentScheme;
+
+   if(!StreamInputHasNext(stream))
+      return scheme;
+
+   next = stream->input->b + stream->inputNext;
+   value = next[0];
+
+   switch(scheme)
+   {
+      case DmtxSchemeAscii:
+         /* Digit pairs never leave ASCII */
+         if(stream->inputNext + 1 < stream->input->length && ISDIGIT(next[0]) && ISDIGIT(next[1]))
+            return scheme;
+         break;
+      case DmtxSchemeC40:
+      case DmtxSchemeText:
+      case DmtxSchemeX12:
+         if(stream->outputChainValueCount % 3 != 0)
+            return scheme;
+         break;
+      case DmtxSchemeEdifact:
+         if(stream->outputChainValueCount % 4 != 0 && IsNativeValue(value, scheme, stream->fnc1))
+            return scheme;
+         break;
+      default:
+         break;
+   }
+
+   scheme = LookAheadTest(stream->input, stream->inputNext, scheme, stream->fnc1);
+
+   /* X12, EDIFACT, and Base 256 have no shift for values outside their
+      sets, and X12 must be able to write the whole triplet */
+   count = (scheme == DmtxSchemeX12) ? 3 : 1;
+   for(i = 0; i < count && stream->inputNext + i < stream->input->length; i++)
+   {
+      if(!IsNativeValue(next[i], scheme, stream->fnc1) &&
+            (scheme == DmtxSchemeX12 || scheme == DmtxSchemeEdifact || scheme == DmtxSchemeBase256))
+         scheme = DmtxSchemeAscii;
+   }
+
+   return scheme;
+}
+
+/**
+ * \brief  Run the Annex P look-ahead test from a given input position.
+ *         Fractional codeword costs are accumulated in twelfths so every
+ *         scheme's running count stays exact.
+ * \param  input
+ * \param  inputNext First input value to consider
+ * \param  currentScheme
+ * \param  fnc1
+ * \return Scheme that should encode the next input value
+ */
+static DmtxScheme
+LookAheadTest(DmtxByteList *input, int inputNext, DmtxScheme currentScheme, int fnc1)
+{
+   int i, j, value, processed;
+   int count[DmtxSchemeBase256 + 1];
+   int words[DmtxSchemeBase256 + 1];
+   int minOthers, minWords, minCount;
+   DmtxScheme scheme;
+   DmtxBoolean extended;
+   DmtxScheme order[] = { DmtxSchemeEdifact, DmtxSchemeText, DmtxSchemeX12 };
+
+   /* Step J: a latch costs one codeword from ASCII, two from elsewhere */
+   for(scheme = DmtxSchemeAscii; scheme <= DmtxSchemeBase256; scheme++)
+      count[scheme] = (currentScheme == DmtxSchemeAscii) ? 12 : 24;
+   count[DmtxSchemeBase256] += 3;
+   count[DmtxSchemeAscii] -= 12;
+   count[currentScheme] = 0;
+
+   for(processed = 0; ; processed++)
+   {
+      for(scheme = DmtxSchemeAscii; scheme <= DmtxSchemeBase256; scheme++)
+         words[scheme] = (count[scheme] + 11)/12;
+
+      /* Step R: compare once at least 4 values have been counted */
+      if(processed >= 4)
+      {
+         for(scheme = DmtxSchemeC40, minOthers = words[DmtxSchemeC40]; scheme <= DmtxSchemeBase256; scheme++)
+            minOthers = min(minOthers, words[scheme]);
+         if(words[DmtxSchemeAscii] < minOthers)
+            return DmtxSchemeAscii;
+
+         if(words[DmtxSchemeBase256] < words[DmtxSchemeAscii] ||
+               words[DmtxSchemeBase256] + 1 < min(min(words[DmtxSchemeC40], words[DmtxSchemeText]),
+               min(words[DmtxSchemeX12], words[DmtxSchemeEdifact])))
+            return DmtxSchemeBase256;
+
+         for(j = 0; j < 3; j++)
+         {
+            scheme = order[j];
+            for(i = DmtxSchemeAscii, minOthers = INT_MAX; i <= DmtxSchemeBase256; i++)
+            {
+               if(i != (int)scheme)
+                  minOthers = min(minOthers, words[i]);
+            }
+
+            if(words[scheme] + 1 < minOthers)
+               return scheme;
+         }
+
+         /* C40 only has to beat X12 outright or on a tie as described below */
+         minOthers = min(min(words[DmtxSchemeAscii], words[DmtxSchemeText]),
+               min(words[DmtxSchemeEdifact], words[DmtxSchemeBase256]));
+
+         if(words[DmtxSchemeC40] + 1 < minOthers)
+         {
+            if(words[DmtxSchemeC40] < words[DmtxSchemeX12])
+               return DmtxSchemeC40;
+
+            if(words[DmtxSchemeC40] == words[DmtxSchemeX12])
+            {
+               /* X12 wins if a terminator or separator comes before any
+                  value outside X12 */
+               for(i = inputNext + processed; i < input->length; i++)
+               {
+                  value = input->b[i];
+                  if(value == 13 || value == 42 || value == 62)
+                     return DmtxSchemeX12;
+                  if(!IsNativeValue(value, DmtxSchemeX12, fnc1))
+                     break;
+               }
+               return DmtxSchemeC40;
+            }
+         }
+      }
+
+      /* Step K: end of data */
+      if(inputNext + processed == input->length)
+      {
+         minWords = words[DmtxSchemeAscii];
+         for(scheme = DmtxSchemeC40; scheme <= DmtxSchemeBase256; scheme++)
+            minWords = min(minWords, words[scheme]);
+
+         if(words[DmtxSchemeAscii] == minWords)
+            return DmtxSchemeAscii;
+
+         minCount = 0;
+         for(scheme = DmtxSchemeC40; scheme <= DmtxSchemeBase256; scheme++)
+            minCount += (words[scheme] == minWords) ? 1 : 0;
+
+         if(minCount == 1)
+         {
+            if(words[DmtxSchemeBase256] == minWords)
+               return DmtxSchemeBase256;
+            if(words[DmtxSchemeEdifact] == minWords)
+               return DmtxSchemeEdifact;
+            if(words[DmtxSchemeText] == minWords)
+               return DmtxSchemeText;
+            if(words[DmtxSchemeX12] == minWords)
+               return DmtxSchemeX12;
+         }
+
+         return DmtxSchemeC40;
+      }
+
+      value = input->b[inputNext + processed];
+      extended = (value > 127 && value != fnc1) ? DmtxTrue : DmtxFalse;
+
+      /* Step L: ASCII */
+      if(ISDIGIT(value))
+      {
+         count[DmtxSchemeAscii] += 6;
+      }
+      else
+      {
+         count[DmtxSchemeAscii] = words[DmtxSchemeAscii] * 12;
+         count[DmtxSchemeAscii] += (extended == DmtxTrue) ? 24 : 12;
+      }
+
+      /* Steps M, N, O, and P: C40, Text, X12, and EDIFACT */
+      for(scheme = DmtxSchemeC40; scheme <= DmtxSchemeEdifact; scheme++)
+      {
+         if(IsNativeValue(value, scheme, fnc1))
+            count[scheme] += (scheme == DmtxSchemeEdifact) ? 9 : 8;
+         else if(scheme == DmtxSchemeX12)
+            count[scheme] += (extended == DmtxTrue) ? 52 : 40;
+         else if(scheme == DmtxSchemeEdifact)
+            count[scheme] += (extended == DmtxTrue) ? 51 : 39;
+         else
+            count[scheme] += (extended == DmtxTrue) ? 32 : 16;
+      }
+
+      /* Step Q: Base 256, where FNC1 is charged four codewords */
+      count[DmtxSchemeBase256] += (value == fnc1) ? 48 : 12;
+   }
+}
+
+/**
+ * \brief  Check whether a value is encoded without shifts in a scheme
+ * \param  value
+ * \param  scheme
+ * \param  fnc1
+ * \return DmtxTrue | DmtxFalse
+ */
+static DmtxBoolean
+IsNativeValue(int value, DmtxScheme scheme, int fnc1)
+{
+   DmtxBoolean isNative;
+
+   if(fnc1 != DmtxUndefined && value == fnc1)
+      return (scheme == DmtxSchemeAscii) ? DmtxTrue : DmtxFalse;
+
+   switch(scheme)
+   {
+      case DmtxSchemeAscii:
+         isNative = (value < 128) ? DmtxTrue : DmtxFalse;
+         break;
+      case DmtxSchemeC40:
+         isNative = (value == 32 || ISDIGIT(value) || (value >= 'A' && value <= 'Z')) ? DmtxTrue : DmtxFalse;
+         break;
+      case DmtxSchemeText:
+         isNative = (value == 32 || ISDIGIT(value) || (value >= 'a' && value <= 'z')) ? DmtxTrue : DmtxFalse;
+         break;
+      case DmtxSchemeX12:
+         isNative = (value == 13 || value == 42 || value == 62 || value == 32 ||
+               ISDIGIT(value) || (value >= 'A' && value <= 'Z')) ? DmtxTrue : DmtxFalse;
+         break;
+      case DmtxSchemeEdifact:
+         isNative = (value >= 32 && value <= 94) ? DmtxTrue : DmtxFalse;
+         break;
+      default:
+         isNative = DmtxTrue;
+         break;
+   }
+
+   return isNative;
+}
@@ -86,10 +86,10 @@
  */
 #ifdef HAVE_READER_PROGRAMMING
     static int
-    EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, DmtxBoolean bReaderProgramming)
+    EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount, DmtxBoolean bReaderProgramming)
 #else
     static int
-    EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1)
+    EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount)
 #endif
 {
    DmtxEncodeStream stream;
@@ -113,12 +113,20 @@
 
    /* Continue encoding until complete */
    while(stream.status == DmtxStatusEncoding)
+   {
+      /* Binary runs are written in one pass rather than byte by byte */
+      if(scheme == DmtxSchemeBase256 && EncodeBase256Run(&stream, sizeIdxRequest) == DmtxPass)
+         continue;
+
       EncodeNextChunk(&stream, scheme, DmtxEncodeNormal, sizeIdxRequest);
+   }
 
    /* Verify encoding completed and all inputs were consumed */
    if(stream.status != DmtxStatusComplete || StreamInputHasNext(&stream))
       return DmtxUndefined;
 
+   *padCount = stream.padCount;
+
    return stream.sizeIdx;
 }
 
@@ -32,33 +32,12 @@ StreamInit(DmtxByteList *input, DmtxByteList *output)
    stream.outputChainWordCount = 0;
    stream.reason = NULL;
    stream.sizeIdx = DmtxUndefined;
+   stream.padCount = 0;
    stream.status = DmtxStatusEncoding;
 
    return stream;
 }
 
-/**
- *
- *
- */
-static void
-StreamCopy(DmtxEncodeStream *dst, DmtxEncodeStream *src)
-{
-   DmtxPassFail passFail;
-
-   dst->currentScheme = src->currentScheme;
-   dst->inputNext = src->inputNext;
-   dst->outputChainValueCount = src->outputChainValueCount;
-   dst->outputChainWordCount = src->outputChainWordCount;
-   dst->reason = src->reason;
-   dst->sizeIdx = src->sizeIdx;
-   dst->status = src->status;
-   dst->input = src->input;
-   dst->fnc1 = src->fnc1;
-
-   dmtxByteListCopy(dst->output, src->output, &passFail);
-}
-
 /**
  *
  *
@@ -113,30 +92,6 @@ StreamOutputChainAppend(DmtxEncodeStream *stream, DmtxByte value)
       StreamMarkFatal(stream, DmtxErrorOutOfBounds);
 }
 
-/**
- * pop off newest/last
- * used for edifact
- */
-static DmtxByte
-StreamOutputChainRemoveLast(DmtxEncodeStream *stream)
-{
-   DmtxByte value;
-   DmtxPassFail passFail;
-
-   if(stream->outputChainWordCount > 0)
-   {
-      value = dmtxByteListPop(stream->output, &passFail);
-      stream->outputChainWordCount--;
-   }
-   else
-   {
-      value = 0;
-      StreamMarkFatal(stream, DmtxErrorEmptyList);
-   }
-
-   return value;
-}
-
 /**
  * overwrite arbitrary element
  * used for binary length changes
@@ -0,0 +1,921 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2010 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxhough.c
+ * \brief Hough transform region detection
+ */
+
+/**
+ * In DmtxDetectHough mode the region of interest is divided into 64x64 tiles
+ * that are screened independently. Each tile is run through a Sobel filter,
+ * edges are located at zero crossings of the Sobel derivative, and edges are
+ * accumulated into a local line Hough. A tile is only considered further if
+ * two well separated line angles both show a regular grid timing. Points
+ * along the strongest lines of a promising tile (typically the finder bars)
+ * are then handed to the usual region fitting in dmtxRegionScanPixel().
+ *
+ * Screening costs a few operations per pixel, so large images that contain
+ * mostly background are searched much faster than by tracing edges from
+ * every scan grid location. Scratch buffers are allocated on first use and
+ * reused for every tile until the decode struct is destroyed.
+ */
+
+#define DmtxHoughTimingMin          0.08 /* Minimum share of energy at timing period */
+#define DmtxHoughPhiSeparation        36 /* Minimum angle between grid directions */
+#define DmtxHoughOffsetBits           23 /* Fraction bits of 1/256 pixel location times 1/32768 term */
+
+/* Sobel grid, derivative direction, and line angles for each accel grid */
+static const int accelSobel[] = { DmtxEdgeVertical, DmtxEdgeBackslash,
+      DmtxEdgeBackslash, DmtxEdgeHorizontal, DmtxEdgeSlash, DmtxEdgeSlash };
+static const int accelType[] = { DmtxEdgeVertical, DmtxEdgeVertical,
+      DmtxEdgeHorizontal, DmtxEdgeHorizontal, DmtxEdgeHorizontal, DmtxEdgeVertical };
+static const int accelPhiBeg[] = { -16, 16, 32, 48, 80, 96 };
+static const int accelPhiEnd[] = {  16, 32, 48, 80, 96, 112 };
+
+/**
+ * \brief  Allocate Hough scan state and scratch buffers
+ * \return Initialized DmtxHoughScan struct
+ */
+static DmtxHoughScan *
+HoughScanCreate(void)
+{
+   int i, phi;
+   int extent;
+   double phiRad, sinPhi, cosPhi, scale, shift;
+   DmtxHoughScan *scan;
+
+   scan = (DmtxHoughScan *)calloc(1, sizeof(DmtxHoughScan));
+   if(scan == NULL)
+      return NULL;
+
+   extent = DmtxHoughLocalSize;
+
+   /* Pixels carry a 2 pixel border so Sobel and accel grids cover the tile */
+   scan->pixel = ValueGridCreate(extent + 4, extent + 4, DmtxUndefined, NULL);
+   if(scan->pixel == NULL) {
+      HoughScanDestroy(&scan);
+      return NULL;
+   }
+
+   for(i = 0; i < 4; i++) {
+      scan->sobel[i] = ValueGridCreate(extent + 2, extent + 2, i, scan->pixel);
+      if(scan->sobel[i] == NULL) {
+         HoughScanDestroy(&scan);
+         return NULL;
+      }
+   }
+
+   for(i = 0; i < 6; i++) {
+      if(accelType[i] == DmtxEdgeVertical)
+         scan->accel[i] = ValueGridCreate(extent + 1, extent, accelType[i],
+               scan->sobel[accelSobel[i]]);
+      else
+         scan->accel[i] = ValueGridCreate(extent, extent + 1, accelType[i],
+               scan->sobel[accelSobel[i]]);
+
+      if(scan->accel[i] == NULL) {
+         HoughScanDestroy(&scan);
+         return NULL;
+      }
+   }
+
+   /* Line offsets are compacted so every angle spans d = 0..extent */
+   for(phi = 0; phi < DmtxHoughPhiExtent; phi++) {
+      phiRad = phi * M_PI/DmtxHoughPhiExtent;
+      sinPhi = sin(phiRad);
+      cosPhi = cos(phiRad);
+
+      if(phi <= DmtxHoughPhiExtent/2) {
+         scale = 1.0/(sinPhi + cosPhi);
+         shift = 0.0;
+      }
+      else {
+         scale = 1.0/(sinPhi - cosPhi);
+         shift = -cosPhi * extent * scale;
+      }
+
+      scan->phiCos[phi] = (int)floor(cosPhi * scale * 32768.0 + 0.5);
+      scan->phiSin[phi] = (int)floor(sinPhi * scale * 32768.0 + 0.5);
+      scan->phiShift[phi] = (int)floor(shift * (1 << DmtxHoughOffsetBits) + 0.5);
+   }
+
+   for(i = 0; i < extent; i++) {
+      scan->dftCos[i] = cos(i * 2.0 * M_PI/extent);
+      scan->dftSin[i] = sin(i * 2.0 * M_PI/extent);
+   }
+
+   return scan;
+}
+
+/**
+ * \brief  Free Hough scan state and scratch buffers
+ * \param  scan
+ * \return void
+ */
+static void
+HoughScanDestroy(DmtxHoughScan **scan)
+{
+   int i;
+
+   if(scan == NULL || *scan == NULL)
+      return;
+
+   for(i = 0; i < 6; i++)
+      ValueGridDestroy(&((*scan)->accel[i]));
+
+   for(i = 0; i < 4; i++)
+      ValueGridDestroy(&((*scan)->sobel[i]));
+
+   ValueGridDestroy(&((*scan)->pixel));
+
+   free(*scan);
+   *scan = NULL;
+}
+
+/**
+ * \brief  Restart tile screening over current region of interest
+ * \param  dec
+ * \return void
+ */
+static void
+HoughScanReset(DmtxDecode *dec)
+{
+   DmtxHoughScan *scan;
+
+   scan = dec->hough;
+   if(scan == NULL)
+      return;
+
+   scan->tileCols = (dec->xMax - dec->xMin + DmtxHoughLocalSize) / DmtxHoughLocalSize;
+   scan->tileRows = (dec->yMax - dec->yMin + DmtxHoughLocalSize) / DmtxHoughLocalSize;
+   scan->tileIdx = 0;
+   scan->seedIdx = 0;
+   scan->seedCount = 0;
+}
+
+/**
+ * \brief  Return the next seed location from a promising tile, screening
+ *         the next tile if current seeds are used up. Rejected tiles return
+ *         DmtxRangeBad so the caller can check scan limits between tiles.
+ * \param  dec
+ * \param  locPtr
+ * \return DmtxRangeGood | DmtxRangeBad | DmtxRangeEnd
+ */
+static int
+PopHoughLocation(DmtxDecode *dec, DmtxPixelLoc *locPtr)
+{
+   DmtxHoughScan *scan;
+
+   if(dec->hough == NULL) {
+      dec->hough = HoughScanCreate();
+      if(dec->hough == NULL)
+         return DmtxRangeEnd;
+      HoughScanReset(dec);
+   }
+
+   scan = dec->hough;
+
+   if(scan->seedIdx >= scan->seedCount) {
+      if(scan->tileIdx >= scan->tileCols * scan->tileRows) {
+         locPtr->X = locPtr->Y = -1;
+         return DmtxRangeEnd;
+      }
+
+      HoughScreenTile(dec, scan);
+      scan->tileIdx++;
+
+      if(scan->seedCount == 0)
+         return DmtxRangeBad;
+   }
+
+   *locPtr = scan->seed[scan->seedIdx++];
+
+   return DmtxRangeGood;
+}
+
+/**
+ * \brief  Screen current tile for a grid pattern and collect seed locations
+ * \param  dec
+ * \param  scan
+ * \return DmtxPass if tile looks like it contains a symbol
+ */
+static DmtxPassFail
+HoughScreenTile(DmtxDecode *dec, DmtxHoughScan *scan)
+{
+   int i, j, k, d;
+   int phi, phiDiff;
+   int dBest[2];
+   DmtxHoughAngleSort angles;
+   DmtxTiming timing[DmtxHoughAngleSortMax];
+   DmtxHoughLocal *line;
+
+   line = &(scan->line);
+   line->xOrigin = dec->xMin + (scan->tileIdx % scan->tileCols) * DmtxHoughLocalSize;
+   line->yOrigin = dec->yMin + (scan->tileIdx / scan->tileCols) * DmtxHoughLocalSize;
+
+   scan->seedIdx = 0;
+   scan->seedCount = 0;
+
+   PixelPopulate(dec, scan);
+   SobelPopulate(scan);
+   AccelPopulate(scan);
+
+   /* Nothing to find in flat background */
+   if(LineHoughAccumulate(dec, scan) < DmtxHoughLocalSize/4)
+      return DmtxFail;
+
+   MaximaHoughAccumulate(&(scan->maxima), line);
+
+   angles = FindDominantAngles(&(scan->maxima));
+   for(i = 0; i < angles.count; i++)
+      timing[i] = FindGridTiming(scan, angles.bucket[i].phi);
+
+   /* Strongest pair of distinct angles that both carry grid timing */
+   for(i = 0; i < angles.count; i++) {
+      if(timing[i].mag < DmtxHoughTimingMin)
+         continue;
+
+      for(j = i + 1; j < angles.count; j++) {
+         if(timing[j].mag < DmtxHoughTimingMin)
+            continue;
+
+         phiDiff = abs(angles.bucket[i].phi - angles.bucket[j].phi);
+         if(phiDiff > DmtxHoughPhiExtent/2)
+            phiDiff = DmtxHoughPhiExtent - phiDiff;
+
+         if(phiDiff < DmtxHoughPhiSeparation)
+            continue;
+
+         if(timing[i].period > 2.0 * timing[j].period ||
+               timing[j].period > 2.0 * timing[i].period)
+            continue;
+
+         /* Seed along the two strongest lines in each direction, which
+            favors the solid finder bars over broken data module edges */
+         for(k = 0; k < 2; k++) {
+            phi = (k == 0) ? angles.bucket[i].phi : angles.bucket[j].phi;
+            dBest[0] = dBest[1] = DmtxUndefined;
+            for(d = 0; d < DmtxHoughLocalSize; d++) {
+               if(dBest[0] == DmtxUndefined || line->bucket[phi][d] > line->bucket[phi][dBest[0]]) {
+                  dBest[1] = dBest[0];
+                  dBest[0] = d;
+               }
+               else if(dBest[1] == DmtxUndefined || line->bucket[phi][d] > line->bucket[phi][dBest[1]]) {
+                  dBest[1] = d;
+               }
+            }
+            AddLineSeeds(dec, scan, phi, dBest[0]);
+            AddLineSeeds(dec, scan, phi, dBest[1]);
+         }
+
+         return DmtxPass;
+      }
+   }
+
+   return DmtxFail;
+}
+
+/**
+ * \brief  Allocate value grid
+ * \param  width
+ * \param  height
+ * \param  type
+ * \param  ref
+ * \return Initialized DmtxValueGrid struct
+ */
+static DmtxValueGrid *
+ValueGridCreate(int width, int height, int type, DmtxValueGrid *ref)
+{
+   DmtxValueGrid *valueGrid;
+
+   valueGrid = (DmtxValueGrid *)calloc(1, sizeof(DmtxValueGrid));
+   if(valueGrid == NULL)
+      return NULL;
+
+   valueGrid->width = width;
+   valueGrid->height = height;
+   valueGrid->type = type;
+   valueGrid->ref = ref;
+
+   valueGrid->value = (int *)malloc(width * height * sizeof(int));
+   if(valueGrid->value == NULL) {
+      ValueGridDestroy(&valueGrid);
+      return NULL;
+   }
+
+   return valueGrid;
+}
+
+/**
+ * \brief  Free value grid
+ * \param  valueGrid
+ * \return void
+ */
+static void
+ValueGridDestroy(DmtxValueGrid **valueGrid)
+{
+   if(valueGrid == NULL || *valueGrid == NULL)
+      return;
+
+   if((*valueGrid)->value != NULL)
+      free((*valueGrid)->value);
+
+   free(*valueGrid);
+   *valueGrid = NULL;
+}
+
+/**
+ * \brief  Load tile pixels (averaged across channels) with a 2 pixel border.
+ *         Locations outside the region of interest repeat the nearest edge.
+ * \param  dec
+ * \param  scan
+ * \return void
+ */
+static void
+PixelPopulate(DmtxDecode *dec, DmtxHoughScan *scan)
+{
+   int i, j, x, y;
+   int channel, channelCount;
+   int offset, sum, value;
+   DmtxBoolean byteChannels;
+   DmtxImage *img;
+   DmtxValueGrid *pixel;
+
+   img = dec->image;
+   pixel = scan->pixel;
+   channelCount = img->channelCount;
+
+   for(byteChannels = DmtxTrue, channel = 0; channel < channelCount; channel++)
+      if(img->bitsPerChannel[channel] != 8)
+         byteChannels = DmtxFalse;
+
+   for(j = 0; j < pixel->height; j++) {
+      y = scan->line.yOrigin + j - 2;
+      y = max(dec->yMin, min(y, dec->yMax));
+
+      for(i = 0; i < pixel->width; i++) {
+         x = scan->line.xOrigin + i - 2;
+         x = max(dec->xMin, min(x, dec->xMax));
+
+         sum = 0;
+         offset = dmtxImageGetByteOffset(img, x * dec->scale, y * dec->scale);
+
+         /* Read byte channels directly rather than one call per channel */
+         if(byteChannels == DmtxTrue && offset != DmtxUndefined) {
+            for(channel = 0; channel < channelCount; channel++)
+               sum += img->pxl[offset + channel];
+         }
+         else {
+            for(channel = 0; channel < channelCount; channel++) {
+               value = 0;
+               dmtxDecodeGetPixelValue(dec, x, y, channel, &value);
+               sum += value;
+            }
+         }
+
+         pixel->value[j * pixel->width + i] = sum / channelCount;
+      }
+   }
+}
+
+/**
+ * \brief  Apply 3x3 Sobel kernels in 4 directions. Each value measures the
+ *         gradient across edges of that orientation (e.g., a vertical edge
+ *         has a horizontal gradient).
+ * \param  scan
+ * \return void
+ */
+static void
+SobelPopulate(DmtxHoughScan *scan)
+{
+   int x, y, w, idx;
+   int colorLoLf, colorLoMd, colorLoRt;
+   int colorMdLf, colorMdRt;
+   int colorHiLf, colorHiMd, colorHiRt;
+   int *pxl;
+   DmtxValueGrid *sobel;
+
+   pxl = scan->pixel->value;
+   w = scan->pixel->width;
+   sobel = scan->sobel[DmtxEdgeVertical];
+
+   for(y = 0; y < sobel->height; y++) {
+      for(x = 0; x < sobel->width; x++) {
+         /* Pixel grid is one location larger on every side */
+         idx = (y + 1) * w + (x + 1);
+         colorLoLf = pxl[idx - w - 1];
+         colorLoMd = pxl[idx - w];
+         colorLoRt = pxl[idx - w + 1];
+         colorMdLf = pxl[idx - 1];
+         colorMdRt = pxl[idx + 1];
+         colorHiLf = pxl[idx + w - 1];
+         colorHiMd = pxl[idx + w];
+         colorHiRt = pxl[idx + w + 1];
+
+         idx = y * sobel->width + x;
+
+         /**
+          *  -1  0  1
+          *  -2  0  2
+          *  -1  0  1
+          */
+         scan->sobel[DmtxEdgeVertical]->value[idx] =
+               (colorHiRt + 2 * colorMdRt + colorLoRt) -
+               (colorHiLf + 2 * colorMdLf + colorLoLf);
+
+         /**
+          *   0  1  2
+          *  -1  0  1
+          *  -2 -1  0
+          */
+         scan->sobel[DmtxEdgeBackslash]->value[idx] =
+               (colorHiMd + 2 * colorHiRt + colorMdRt) -
+               (colorMdLf + 2 * colorLoLf + colorLoMd);
+
+         /**
+          *   1  2  1
+          *   0  0  0
+          *  -1 -2 -1
+          */
+         scan->sobel[DmtxEdgeHorizontal]->value[idx] =
+               (colorHiLf + 2 * colorHiMd + colorHiRt) -
+               (colorLoLf + 2 * colorLoMd + colorLoRt);
+
+         /**
+          *  -2 -1  0
+          *  -1  0  1
+          *   0  1  2
+          */
+         scan->sobel[DmtxEdgeSlash]->value[idx] =
+               (colorMdRt + 2 * colorLoRt + colorLoMd) -
+               (colorHiMd + 2 * colorHiLf + colorMdLf);
+      }
+   }
+}
+
+/**
+ * \brief  Take derivative of each Sobel grid across its edge direction.
+ *         Vertical accel grids step in X and horizontal grids step in Y.
+ * \param  scan
+ * \return void
+ */
+static void
+AccelPopulate(DmtxHoughScan *scan)
+{
+   int i, x, y;
+   int sInc, sIdx, aIdx;
+   DmtxValueGrid *acc, *sob;
+
+   for(i = 0; i < 6; i++) {
+      acc = scan->accel[i];
+      sob = acc->ref;
+
+      /* Vertical grids start on tile row, horizontal grids on tile column */
+      if(acc->type == DmtxEdgeVertical) {
+         sInc = 1;
+         sIdx = sob->width;
+      }
+      else {
+         sInc = sob->width;
+         sIdx = 1;
+      }
+
+      for(y = 0; y < acc->height; y++) {
+         aIdx = y * acc->width;
+         for(x = 0; x < acc->width; x++) {
+            acc->value[aIdx + x] = sob->value[sIdx + x + sInc] - sob->value[sIdx + x];
+         }
+         sIdx += sob->width;
+      }
+   }
+}
+
+/**
+ * \brief  Accumulate tile edges into local line Hough. Each location only
+ *         votes through the Sobel kernel with the strongest response, and
+ *         each accel grid only votes for the line angles near that kernel.
+ * \param  dec
+ * \param  scan
+ * \return Number of edges found in tile
+ */
+static int
+LineHoughAccumulate(DmtxDecode *dec, DmtxHoughScan *scan)
+{
+   int i, x, y, phi, type;
+   int edgeCount;
+   int xEnd, yEnd;
+   int edgeThresh;
+   DmtxZeroCrossing edge;
+   DmtxHoughLocal *line;
+
+   line = &(scan->line);
+   memset(line->bucket, 0x00, sizeof(line->bucket));
+
+   /* Same threshold that dmtxRegionScanPixel() applies to its first edge */
+   edgeThresh = (int)(dec->edgeThresh * 7.65 + 0.5);
+
+   xEnd = min(DmtxHoughLocalSize, dec->xMax - line->xOrigin + 1);
+   yEnd = min(DmtxHoughLocalSize, dec->yMax - line->yOrigin + 1);
+
+   edgeCount = 0;
+   for(y = 0; y < yEnd; y++) {
+      for(x = 0; x < xEnd; x++) {
+         type = SobelDominantType(scan, x, y);
+
+         for(i = 0; i < 6; i++) {
+            if(accelSobel[i] != type)
+               continue;
+
+            edge = GetZeroCrossing(scan->accel[i], x, y, edgeThresh);
+            if(edge.mag == 0)
+               continue;
+
+            edgeCount++;
+
+            for(phi = accelPhiBeg[i]; phi < accelPhiEnd[i]; phi++) {
+               line->bucket[phi & 0x7f][HoughGetLocalOffset(scan, edge.x, edge.y,
+                     phi & 0x7f)] += edge.mag;
+            }
+         }
+      }
+   }
+
+   return edgeCount;
+}
+
+/**
+ * \brief  Find Sobel kernel with the strongest response at tile location
+ * \param  scan
+ * \param  x Tile X coordinate
+ * \param  y Tile Y coordinate
+ * \return DmtxEdgeType of strongest kernel
+ */
+static int
+SobelDominantType(DmtxHoughScan *scan, int x, int y)
+{
+   int i, idx, type;
+   int mag, magBest;
+
+   idx = (y + 1) * scan->sobel[0]->width + (x + 1);
+
+   type = DmtxEdgeVertical;
+   magBest = abs(scan->sobel[DmtxEdgeVertical]->value[idx]);
+
+   for(i = DmtxEdgeBackslash; i <= DmtxEdgeSlash; i++) {
+      mag = abs(scan->sobel[i]->value[idx]);
+      if(mag > magBest) {
+         magBest = mag;
+         type = i;
+      }
+   }
+
+   return type;
+}
+
+/**
+ * \brief  Test for edge at tile location, which appears as a peak in Sobel
+ *         magnitude where the derivative changes sign
+ * \param  accel
+ * \param  x Tile X coordinate
+ * \param  y Tile Y coordinate
+ * \param  edgeThresh Minimum Sobel magnitude
+ * \return Edge with sub-pixel location, or zero magnitude if none
+ */
+static DmtxZeroCrossing
+GetZeroCrossing(DmtxValueGrid *accel, int x, int y, int edgeThresh)
+{
+   int aHere, aNext, sobelMag;
+   int smidge;
+   DmtxValueGrid *sobel;
+   DmtxZeroCrossing edge;
+
+   edge.mag = edge.x = edge.y = 0;
+
+   sobel = accel->ref;
+   sobelMag = sobel->value[(y + 1) * sobel->width + (x + 1)];
+   if(abs(sobelMag) < edgeThresh)
+      return edge;
+
+   aHere = accel->value[y * accel->width + x];
+   if(accel->type == DmtxEdgeVertical)
+      aNext = accel->value[y * accel->width + x + 1];
+   else
+      aNext = accel->value[(y + 1) * accel->width + x];
+
+   if(sobelMag > 0 && (aHere <= 0 || aNext > 0))
+      return edge;
+   else if(sobelMag < 0 && (aHere >= 0 || aNext < 0))
+      return edge;
+
+   /* Vertex of parabola through the 3 Sobel values, within half a pixel */
+   smidge = (128 * (aHere + aNext))/(aHere - aNext);
+
+   edge.mag = abs(sobelMag);
+   edge.x = x * 256 + 128;
+   edge.y = y * 256 + 128;
+
+   if(accel->type == DmtxEdgeVertical)
+      edge.x += smidge;
+   else
+      edge.y += smidge;
+
+   return edge;
+}
+
+/**
+ * \brief  Find compacted Hough offset of line through tile location
+ * \param  scan
+ * \param  x Tile X coordinate in 1/256 pixel units
+ * \param  y Tile Y coordinate in 1/256 pixel units
+ * \param  phi
+ * \return Offset bucket between 0 and DmtxHoughLocalSize - 1
+ */
+static int
+HoughGetLocalOffset(DmtxHoughScan *scan, int x, int y, int phi)
+{
+   int d;
+
+   d = (x * scan->phiCos[phi] + y * scan->phiSin[phi] + scan->phiShift[phi]) >> DmtxHoughOffsetBits;
+
+   return max(0, min(d, DmtxHoughLocalSize - 1));
+}
+
+/**
+ * \brief  Weight line Hough buckets by how sharply they peak above their
+ *         neighbors at the same angle
+ * \param  maxima
+ * \param  line
+ * \return void
+ */
+static void
+MaximaHoughAccumulate(DmtxHoughLocal *maxima, DmtxHoughLocal *line)
+{
+   int phi, d;
+
+   maxima->xOrigin = line->xOrigin;
+   maxima->yOrigin = line->yOrigin;
+
+   for(phi = 0; phi < DmtxHoughPhiExtent; phi++)
+      for(d = 0; d < DmtxHoughLocalSize; d++)
+         maxima->bucket[phi][d] = GetMaximaWeight(line, phi, d);
+}
+
+/**
+ * \brief  Weight of line Hough bucket, or zero if it isn't a local maximum
+ * \param  line
+ * \param  phi
+ * \param  d
+ * \return Maxima weight
+ */
+static int
+GetMaximaWeight(DmtxHoughLocal *line, int phi, int d)
+{
+   int val, valDn, valUp, valDnDn, valUpUp;
+   int weight;
+
+   val = line->bucket[phi][d];
+   valDn = (d >= 1) ? line->bucket[phi][d - 1] : 0;
+   valUp = (d <= DmtxHoughLocalSize - 2) ? line->bucket[phi][d + 1] : 0;
+
+   /* Line is outranked by immediate neighbor in same direction */
+   if(valDn > val || valUp > val)
+      return 0;
+
+   valDnDn = (d >= 2) ? line->bucket[phi][d - 2] : 0;
+   valUpUp = (d <= DmtxHoughLocalSize - 3) ? line->bucket[phi][d + 2] : 0;
+
+   weight = (5 * val) - (valUp + valDn) - 2 * (valUpUp + valDnDn);
+
+   return (weight > 0) ? weight : 0;
+}
+
+/**
+ * \brief  Rank line angles by the sum of their 8 strongest maxima. A grid
+ *         produces many parallel lines, so its directions stand out even
+ *         when individual module edges are short.
+ * \param  maxima
+ * \return Strongest angles, at least 10 buckets apart
+ */
+static DmtxHoughAngleSort
+FindDominantAngles(DmtxHoughLocal *maxima)
+{
+   int i, d, val;
+   int top[8];
+   DmtxHoughBucket bucket;
+   DmtxHoughAngleSort sort;
+
+   memset(&sort, 0x00, sizeof(DmtxHoughAngleSort));
+
+   for(bucket.phi = 0; bucket.phi < DmtxHoughPhiExtent; bucket.phi++) {
+      memset(top, 0x00, sizeof(top));
+
+      for(d = 0; d < DmtxHoughLocalSize; d++) {
+         val = maxima->bucket[bucket.phi][d];
+         if(val <= top[7])
+            continue;
+
+         for(i = 7; i > 0 && val > top[i-1]; i--)
+            top[i] = top[i-1];
+         top[i] = val;
+      }
+
+      bucket.d = 0;
+      bucket.val = 0;
+      for(i = 0; i < 8; i++)
+         bucket.val += top[i];
+
+      if(bucket.val > 0)
+         AddToAngleSort(&sort, bucket);
+   }
+
+   return sort;
+}
+
+/**
+ * \brief  Insert angle into sort, replacing a weaker entry at a similar angle
+ * \param  sort
+ * \param  bucket
+ * \return void
+ */
+static void
+AddToAngleSort(DmtxHoughAngleSort *sort, DmtxHoughBucket bucket)
+{
+   int i, startHere;
+   int phiDiff;
+   DmtxBoolean isFull;
+   DmtxHoughBucket *lastBucket;
+
+   isFull = (sort->count == DmtxHoughAngleSortMax) ? DmtxTrue : DmtxFalse;
+   lastBucket = &(sort->bucket[DmtxHoughAngleSortMax - 1]);
+
+   /* Array is full and incoming bucket is already weakest */
+   if(isFull && bucket.val < lastBucket->val)
+      return;
+
+   startHere = DmtxUndefined;
+
+   /* If sort already has entry near this angle then either overwrite the
+    * old one without shifting if stronger, or reject the new one if weaker */
+   for(i = 0; i < sort->count; i++) {
+      phiDiff = abs(bucket.phi - sort->bucket[i].phi);
+      if(phiDiff > DmtxHoughPhiExtent/2)
+         phiDiff = DmtxHoughPhiExtent - phiDiff;
+
+      if(phiDiff < 10) {
+         if(bucket.val < sort->bucket[i].val)
+            return;
+
+         sort->bucket[i] = bucket;
+         startHere = i;
+         break;
+      }
+   }
+
+   if(startHere == DmtxUndefined) {
+      if(isFull)
+         *lastBucket = bucket;
+      else
+         sort->bucket[sort->count++] = bucket;
+
+      startHere = sort->count - 1;
+   }
+
+   /* Shift weak entries downward */
+   for(i = startHere; i > 0 && bucket.val > sort->bucket[i-1].val; i--) {
+      sort->bucket[i] = sort->bucket[i-1];
+      sort->bucket[i-1] = bucket;
+   }
+}
+
+/**
+ * \brief  Find period of parallel lines at a given angle from the spectrum
+ *         of line Hough offsets. Periods between 2 and 16 pixels are
+ *         considered, and mag reports how much of the varying energy falls
+ *         at the strongest one.
+ * \param  scan
+ * \param  phi
+ * \return Grid timing
+ */
+static DmtxTiming
+FindGridTiming(DmtxHoughScan *scan, int phi)
+{
+   int d, k, kBest;
+   double mean, val, re, im;
+   double mag, magBest, magTotal;
+   DmtxTiming timing;
+
+   mean = 0.0;
+   for(d = 0; d < DmtxHoughLocalSize; d++)
+      mean += scan->line.bucket[phi][d];
+   mean /= DmtxHoughLocalSize;
+
+   kBest = 0;
+   magBest = magTotal = 0.0;
+
+   for(k = 1; k <= DmtxHoughLocalSize/2; k++) {
+      re = im = 0.0;
+      for(d = 0; d < DmtxHoughLocalSize; d++) {
+         val = scan->line.bucket[phi][d] - mean;
+         re += val * scan->dftCos[(k * d) & (DmtxHoughLocalSize - 1)];
+         im += val * scan->dftSin[(k * d) & (DmtxHoughLocalSize - 1)];
+      }
+
+      mag = re * re + im * im;
+      magTotal += mag;
+
+      if(k >= DmtxHoughLocalSize/16 && mag > magBest) {
+         magBest = mag;
+         kBest = k;
+      }
+   }
+
+   timing.phi = phi;
+   timing.period = (kBest > 0) ? (double)DmtxHoughLocalSize/kBest : 0.0;
+   timing.mag = (magTotal > 0.0) ? magBest/magTotal : 0.0;
+
+   return timing;
+}
+
+/**
+ * \brief  Add seed locations at every 4th edge lying on a Hough line. Only
+ *         locations within a pixel or so of the line are tested.
+ * \param  dec
+ * \param  scan
+ * \param  phi
+ * \param  d
+ * \return void
+ */
+static void
+AddLineSeeds(DmtxDecode *dec, DmtxHoughScan *scan, int phi, int d)
+{
+   int i, t, u, x, y, type;
+   int tEnd, xEnd, yEnd;
+   int edgeThresh, edgeCount;
+   double cosPhi, sinPhi, shift, center;
+   DmtxBoolean steep;
+   DmtxZeroCrossing edge;
+   DmtxHoughLocal *line;
+
+   if(d == DmtxUndefined)
+      return;
+
+   line = &(scan->line);
+   edgeThresh = (int)(dec->edgeThresh * 7.65 + 0.5);
+
+   xEnd = min(DmtxHoughLocalSize, dec->xMax - line->xOrigin + 1);
+   yEnd = min(DmtxHoughLocalSize, dec->yMax - line->yOrigin + 1);
+
+   cosPhi = scan->phiCos[phi] / 32768.0;
+   sinPhi = scan->phiSin[phi] / 32768.0;
+   shift = scan->phiShift[phi] / (double)(1 << DmtxHoughOffsetBits);
+
+   /* Step along the long axis of the line and solve for the other one */
+   steep = (fabs(cosPhi) > fabs(sinPhi)) ? DmtxTrue : DmtxFalse;
+   tEnd = (steep == DmtxTrue) ? yEnd : xEnd;
+
+   edgeCount = 0;
+   for(t = 0; t < tEnd; t++) {
+      if(steep == DmtxTrue)
+         center = (d + 0.5 - (t + 0.5) * sinPhi - shift)/cosPhi - 0.5;
+      else
+         center = (d + 0.5 - (t + 0.5) * cosPhi - shift)/sinPhi - 0.5;
+
+      for(u = (int)floor(center) - 1; u <= (int)floor(center) + 2; u++) {
+         x = (steep == DmtxTrue) ? u : t;
+         y = (steep == DmtxTrue) ? t : u;
+         if(x < 0 || x >= xEnd || y < 0 || y >= yEnd)
+            continue;
+
+         type = SobelDominantType(scan, x, y);
+
+         for(i = 0; i < 6; i++) {
+            if(accelSobel[i] != type ||
+                  ((phi - accelPhiBeg[i]) & 0x7f) >= accelPhiEnd[i] - accelPhiBeg[i])
+               continue;
+
+            edge = GetZeroCrossing(scan->accel[i], x, y, edgeThresh);
+            if(edge.mag == 0 || HoughGetLocalOffset(scan, edge.x, edge.y, phi) != d)
+               continue;
+
+            if((edgeCount++ & 0x03) != 0)
+               continue;
+
+            if(scan->seedCount >= DmtxHoughSeedMax)
+               return;
+
+            scan->seed[scan->seedCount].X = line->xOrigin + x;
+            scan->seed[scan->seedCount].Y = line->yOrigin + y;
+            scan->seedCount++;
+         }
+      }
+   }
+}
@@ -98,3 +98,111 @@ dmtxMessageDestroy(DmtxMessage **msg)
 
    return DmtxPass;
 }
+
+/**
+ * \brief  Allocate empty result list
+ * \return Address of allocated memory
+ */
+static DmtxResultList *
+ResultListCreate(void)
+{
+   DmtxResultList *results;
+
+   results = (DmtxResultList *)calloc(1, sizeof(DmtxResultList));
+   if(results == NULL)
+      return NULL;
+
+   results->stopCause = DmtxScanNotFound;
+
+   return results;
+}
+
+/**
+ * \brief  Free result list and the decoded data it holds
+ * \param  results
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxResultListDestroy(DmtxResultList **results)
+{
+   if(results == NULL || *results == NULL)
+      return DmtxFail;
+
+   if((*results)->symbol != NULL)
+      free((*results)->symbol);
+
+   if((*results)->output != NULL)
+      free((*results)->output);
+
+   free(*results);
+
+   *results = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Append decoded symbol to result list. Symbol entries and output
+ *         bytes live in two arrays that grow geometrically, so a long list
+ *         costs only a handful of allocations.
+ * \param  results
+ * \param  dec
+ * \param  reg Region the message was decoded from
+ * \param  msg Decoded message
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+ResultListAdd(DmtxResultList *results, DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg)
+{
+   int i, scale;
+   int capacity;
+   size_t outputSize;
+   unsigned char *output;
+   DmtxSymbolResult *symbol;
+   double cornerX[] = { 0.0, 1.0, 1.0, 0.0 };
+   double cornerY[] = { 0.0, 0.0, 1.0, 1.0 };
+
+   if(results->count == results->capacity) {
+      capacity = (results->capacity == 0) ? 16 : results->capacity * 2;
+      symbol = (DmtxSymbolResult *)realloc(results->symbol, capacity * sizeof(DmtxSymbolResult));
+      if(symbol == NULL)
+         return DmtxFail;
+
+      results->symbol = symbol;
+      results->capacity = capacity;
+   }
+
+   if(results->outputIdx + (size_t)msg->outputIdx > results->outputSize) {
+      outputSize = (results->outputSize == 0) ? 1024 : results->outputSize;
+      while(results->outputIdx + (size_t)msg->outputIdx > outputSize)
+         outputSize *= 2;
+
+      output = (unsigned char *)realloc(results->output, outputSize);
+      if(output == NULL)
+         return DmtxFail;
+
+      results->output = output;
+      results->outputSize = outputSize;
+   }
+
+   symbol = &(results->symbol[results->count]);
+   scale = dmtxDecodeGetProp(dec, DmtxPropScale);
+
+   for(i = 0; i < 4; i++) {
+      symbol->corner[i].X = cornerX[i];
+      symbol->corner[i].Y = cornerY[i];
+      dmtxMatrix3VMultiplyBy(&(symbol->corner[i]), reg->fit2raw);
+      dmtxVector2ScaleBy(&(symbol->corner[i]), (double)scale);
+   }
+
+   symbol->sizeIdx = reg->sizeIdx;
+   symbol->polarity = reg->polarity;
+   symbol->outputIdx = results->outputIdx;
+   symbol->outputLength = msg->outputIdx;
+
+   memcpy(results->output + results->outputIdx, msg->output, msg->outputIdx);
+   results->outputIdx += msg->outputIdx;
+   results->count++;
+
+   return DmtxPass;
+}
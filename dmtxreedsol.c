@@ -26,6 +26,8 @@
 
 #define NN                      255
 #define MAX_ERROR_WORD_COUNT     68
+#define ERASURE_CHECK_WORDS       1 /* Syndromes left unused to check errata repairs */
+#define MAX_INTERLEAVED_BLOCKS   10
 
 /* GF add (a + b) */
 #define GfAdd(a,b) \
@@ -33,11 +35,11 @@
 
 /* GF multiply (a * b) */
 #define GfMult(a,b) \
-   (((a) == 0 || (b) == 0) ? 0 : antilog301[(log301[(a)] + log301[(b)]) % NN])
+   (((a) == 0 || (b) == 0) ? 0 : antilog301[log301[(a)] + log301[(b)]])
 
-/* GF multiply by antilog (a * alpha**b) */
+/* GF multiply by antilog (a * alpha**b), where 0 <= b <= NN */
 #define GfMultAntilog(a,b) \
-   (((a) == 0) ? 0 : antilog301[(log301[(a)] + (b)) % NN])
+   (((a) == 0) ? 0 : antilog301[log301[(a)] + (b)])
 
 /* GF(256) log values using primitive polynomial 301 */
 static DmtxByte log301[] =
@@ -58,7 +60,8 @@ static DmtxByte log301[] =
       58,  69, 148,  18,  15,  16,  68,  17, 121, 149, 129,  19, 155,  59, 249,  70,
      214, 250, 168,  71, 201, 156,  64,  60, 237, 130, 111,  20,  93, 122, 177, 150 };
 
-/* GF(256) antilog values using primitive polynomial 301 */
+/* GF(256) antilog values using primitive polynomial 301, repeated so the sum
+   of two logs (or a log plus an exponent up to NN) indexes without modulo */
 static DmtxByte antilog301[] =
    {   1,   2,   4,   8,  16,  32,  64, 128,  45,  90, 180,  69, 138,  57, 114, 228,
      229, 231, 227, 235, 251, 219, 155,  27,  54, 108, 216, 157,  23,  46,  92, 184,
@@ -75,11 +78,93 @@ static DmtxByte antilog301[] =
      177,  79, 158,  17,  34,  68, 136,  61, 122, 244, 197, 167,  99, 198, 161, 111,
      222, 145,  15,  30,  60, 120, 240, 205, 183,  67, 134,  33,  66, 132,  37,  74,
      148,   5,  10,  20,  40,  80, 160, 109, 218, 153,  31,  62, 124, 248, 221, 151,
-       3,   6,  12,  24,  48,  96, 192, 173, 119, 238, 241, 207, 179,  75, 150,   0 };
+       3,   6,  12,  24,  48,  96, 192, 173, 119, 238, 241, 207, 179,  75, 150,   1,
+       2,   4,   8,  16,  32,  64, 128,  45,  90, 180,  69, 138,  57, 114, 228, 229,
+     231, 227, 235, 251, 219, 155,  27,  54, 108, 216, 157,  23,  46,  92, 184,  93,
+     186,  89, 178,  73, 146,   9,  18,  36,  72, 144,  13,  26,  52, 104, 208, 141,
+      55, 110, 220, 149,   7,  14,  28,  56, 112, 224, 237, 247, 195, 171, 123, 246,
+     193, 175, 115, 230, 225, 239, 243, 203, 187,  91, 182,  65, 130,  41,  82, 164,
+     101, 202, 185,  95, 190,  81, 162, 105, 210, 137,  63, 126, 252, 213, 135,  35,
+      70, 140,  53, 106, 212, 133,  39,  78, 156,  21,  42,  84, 168, 125, 250, 217,
+     159,  19,  38,  76, 152,  29,  58, 116, 232, 253, 215, 131,  43,  86, 172, 117,
+     234, 249, 223, 147,  11,  22,  44,  88, 176,  77, 154,  25,  50, 100, 200, 189,
+      87, 174, 113, 226, 233, 255, 211, 139,  59, 118, 236, 245, 199, 163, 107, 214,
+     129,  47,  94, 188,  85, 170, 121, 242, 201, 191,  83, 166,  97, 194, 169, 127,
+     254, 209, 143,  51, 102, 204, 181,  71, 142,  49,  98, 196, 165, 103, 206, 177,
+      79, 158,  17,  34,  68, 136,  61, 122, 244, 197, 167,  99, 198, 161, 111, 222,
+     145,  15,  30,  60, 120, 240, 205, 183,  67, 134,  33,  66, 132,  37,  74, 148,
+       5,  10,  20,  40,  80, 160, 109, 218, 153,  31,  62, 124, 248, 221, 151,   3,
+       6,  12,  24,  48,  96, 192, 173, 119, 238, 241, 207, 179,  75, 150 };
+
+/* Block error word counts found in the symbol table, and where each one's
+   generator polynomial starts in rsGenPolyLog[] */
+static int rsGenPolyWords[] =
+   {   5,   7,  10,  11,  12,  14,  18,  20,  24,  28,  36,  42,  48,  56,  62,  68 };
+static int rsGenPolyOffset[] =
+   {   0,   5,  12,  22,  33,  45,  59,  77,  97, 121, 149, 185, 227, 275, 331, 393 };
+
+/* Logs of generator polynomial coefficients g[0]..g[n-1], as produced by
+   RsGenPoly(), for each count above. Leading coefficient g[n] = 1 is implied
+   and no coefficient is zero. */
+static DmtxByte rsGenPolyLog[] =
+   {
+     /* 5 */
+      15, 244, 210, 207, 235,
+     /* 7 */
+      28, 197,  42, 218, 214,  30, 177,
+     /* 10 */
+      55, 243,  83, 172, 131, 237, 120, 150,  50, 199,
+     /* 11 */
+      66,  12, 215, 242, 174, 109, 103, 156, 212, 173, 213,
+     /* 12 */
+      78, 233, 194,  74, 199, 107, 185,  94, 173,  35, 142, 168,
+     /* 14 */
+     105, 173, 246,  93,  84,  38,  27, 248,  12,   8,  39,  33, 171,  83,
+     /* 18 */
+     171,  61, 142, 103, 164, 253, 220, 199, 250,  94, 231, 161, 163, 177,  69, 244,
+       9, 164,
+     /* 20 */
+     210,  61, 201,  38, 149, 184, 109,   1, 164, 230, 233, 209, 122, 193,  25,  79,
+      23, 146,  33, 127,
+     /* 24 */
+      45,  85, 136, 215, 231, 103, 137, 106,  22, 202,  20, 131,  22, 106, 225, 127,
+     177, 236, 242, 183,  31, 245, 141,  65,
+     /* 28 */
+     151,  17, 125, 173, 184, 245, 190, 146, 222, 239, 166,  99, 253, 196, 130, 167,
+     195,  12,  50,  94,  48, 198, 213, 239, 149, 109,  32, 150,
+     /* 36 */
+     156, 176, 168, 232,  77, 111,  87, 183, 181, 213, 108, 252,  51,  20, 229,  75,
+      16,  39,   1,   2, 197, 219,  81,  90,  84, 248,  67, 135,  66,  31, 153, 140,
+      69, 187,  86,  57,
+     /* 42 */
+     138,  65,  90, 234, 114, 115, 134, 233,  60,  88, 200,   1, 156, 102, 168,   3,
+      66,  84, 142,  38, 203,  88, 160, 207,  13, 167, 106,   0, 122,  13,  24,  81,
+     237,  82,  11, 141, 254, 192, 148, 225,  38, 225,
+     /* 48 */
+     156, 221, 127, 131, 245,   5, 128, 134, 249, 102, 249,  17, 215, 164,  59, 145,
+     170, 100,   4, 132, 154,  28, 222,   9, 166, 215, 124, 136, 213, 142, 220,  12,
+      33, 214,  79, 135, 137, 145,  73, 132, 230,  66,  11,  94,  30, 122,  69, 114,
+     /* 56 */
+      66,  38, 131, 249, 242, 195,  51,  47, 142, 118,  66, 166,  68, 246, 123,  19,
+     254, 113,  40, 131, 115, 143, 221,  24,  15,  37, 232, 129, 128,  72, 118, 121,
+      42, 249, 134, 254, 169, 128, 235, 251,  80,  43,  90, 156, 176, 217,  60,  55,
+      22, 125,  72, 159, 149,  99, 179,  29,
+     /* 62 */
+     168,  32, 175, 141,  42,  89, 103, 154,  82, 164, 169, 144, 179,  25, 188, 222,
+      83,  57, 218,  68, 156,  91, 202,  85, 111, 100,  83, 238,  66,   6,  14, 184,
+     206, 135, 132, 241,  23, 232, 180,  91, 145, 226, 228,  77, 164, 195, 158, 234,
+     137, 166,   2, 159, 121,  53, 163, 172,  58, 236, 126, 162, 133, 182,
+     /* 68 */
+      51,  15, 247,  34,  20,  52, 113,  56,  34, 219, 132, 201, 139,  40,  36, 176,
+      94, 198, 237,  10, 129, 202, 194, 192, 197, 200,  32,  94, 210, 230,  18, 155,
+     220, 152, 233,  83,  82, 203, 252, 140,  51, 121, 245,  89,  17, 198, 131,  70,
+     183, 250, 153,  45, 127, 140, 186, 121, 151, 144,   6,  24,  25, 233, 221,  91,
+     245, 190,  79,  33 };
 
 /**
  * Encode xyz.
- * More detailed description.
+ * Each block's error codewords come from an LFSR whose taps are the logs of
+ * a precomputed generator polynomial, so each tap costs a single lookup.
  * \param message
  * \param sizeIdx
  * \return Function success (DmtxPass|DmtxFail)
@@ -92,8 +177,9 @@ RsEncode(DmtxMessage *message, int sizeIdx)
    int i, j;
    int blockStride, blockIdx;
    int blockErrorWords, symbolDataWords, symbolErrorWords, symbolTotalWords;
+   int valLog;
    DmtxPassFail passFail;
-   DmtxByte val, *eccPtr;
+   DmtxByte val, *eccPtr, *genLog;
    DmtxByte genStorage[MAX_ERROR_WORD_COUNT];
    DmtxByte eccStorage[MAX_ERROR_WORD_COUNT];
    DmtxByteList gen = dmtxByteListBuild(genStorage, sizeof(genStorage));
@@ -105,8 +191,15 @@ RsEncode(DmtxMessage *message, int sizeIdx)
    symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
    symbolTotalWords = symbolDataWords + symbolErrorWords;
 
-   /* Populate generator polynomial */
-   RsGenPoly(&gen, blockErrorWords);
+   /* Use precomputed generator polynomial, populating one only if needed */
+   genLog = RsFindGenPolyLog(blockErrorWords);
+   if(genLog == NULL)
+   {
+      RsGenPoly(&gen, blockErrorWords);
+      for(j = 0; j < blockErrorWords; j++)
+         gen.b[j] = log301[gen.b[j]];
+      genLog = gen.b;
+   }
 
    /* For each interleaved block... */
    for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
@@ -117,13 +210,21 @@ RsEncode(DmtxMessage *message, int sizeIdx)
       {
          val = GfAdd(ecc.b[blockErrorWords-1], message->code[i]);
 
-         for(j = blockErrorWords - 1; j > 0; j--)
+         /* Feedback of zero only shifts the register */
+         if(val == 0)
          {
-            DMTX_CHECK_BOUNDS(&ecc, j); DMTX_CHECK_BOUNDS(&ecc, j-1); DMTX_CHECK_BOUNDS(&gen, j);
-            ecc.b[j] = GfAdd(ecc.b[j-1], GfMult(gen.b[j], val));
+            for(j = blockErrorWords - 1; j > 0; j--)
+               ecc.b[j] = ecc.b[j-1];
+            ecc.b[0] = 0;
+            continue;
          }
 
-         ecc.b[0] = GfMult(gen.b[0], val);
+         /* Nonzero feedback and generator coefficients multiply as logs */
+         valLog = log301[val];
+         for(j = blockErrorWords - 1; j > 0; j--)
+            ecc.b[j] = GfAdd(ecc.b[j-1], antilog301[valLog + genLog[j]]);
+
+         ecc.b[0] = antilog301[valLog + genLog[0]];
       }
 
       /* Copy to output message */
@@ -137,24 +238,162 @@ RsEncode(DmtxMessage *message, int sizeIdx)
    return DmtxPass;
 }
 
+/**
+ * Find precomputed generator polynomial.
+ * \param errorWordCount
+ * \return Logs of coefficients, or NULL if count isn't in symbol table
+ */
+static DmtxByte *
+RsFindGenPolyLog(int errorWordCount)
+{
+   int i;
+
+   for(i = 0; i < (int)(sizeof(rsGenPolyWords)/sizeof(int)); i++)
+   {
+      if(rsGenPolyWords[i] == errorWordCount)
+         return rsGenPolyLog + rsGenPolyOffset[i];
+   }
+
+   return NULL;
+}
+
 /**
  * Decode xyz.
- * More detailed description.
+ * Syndromes are computed directly from the interleaved codewords, and only
+ * blocks with errors are gathered into a list for repair. When a task runner
+ * is provided and more than one block needs repair, those repairs are handed
+ * to it together. Blocks occupy disjoint codewords, so the outcome doesn't
+ * depend on the order or concurrency with which the runner executes them.
  * \param code
+ * \param erasure Flags marking unreliable codewords (nonzero), or NULL
  * \param sizeIdx
  * \param fix
+ * \param runTasks Caller's task runner, or NULL to repair blocks in turn
+ * \param context Passed through to runTasks
+ * \return Function success (DmtxPass|DmtxFail)
+ */
+static DmtxPassFail
+RsDecode(unsigned char *code, const unsigned char *erasure, int sizeIdx, int fix,
+      DmtxRunTasks runTasks, void *context)
+{
+   int i, repairCount;
+   int blockStride, blockIdx;
+   DmtxRsBlock repair[MAX_INTERLEAVED_BLOCKS];
+   void *repairArg[MAX_INTERLEAVED_BLOCKS];
+
+   blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
+
+   if(blockStride > MAX_INTERLEAVED_BLOCKS)
+      runTasks = NULL;
+
+   /* For each interleaved block */
+   for(repairCount = 0, blockIdx = 0; blockIdx < blockStride; blockIdx++)
+   {
+      if(!RsBlockHasErrors(code, sizeIdx, blockIdx))
+         continue;
+
+      if(runTasks == NULL)
+      {
+         if(RsRepairBlock(code, erasure, sizeIdx, blockIdx) == DmtxFail)
+            return DmtxFail;
+         continue;
+      }
+
+      repair[repairCount].code = code;
+      repair[repairCount].erasure = erasure;
+      repair[repairCount].sizeIdx = sizeIdx;
+      repair[repairCount].blockIdx = blockIdx;
+      repair[repairCount].result = DmtxFail;
+      repairArg[repairCount] = &repair[repairCount];
+      repairCount++;
+   }
+
+   if(repairCount == 1)
+      RsRepairBlockTask(repairArg[0]);
+   else if(repairCount > 1)
+      (*runTasks)(RsRepairBlockTask, repairArg, repairCount, context);
+
+   /* Merge in block order once every repair has finished */
+   for(i = 0; i < repairCount; i++)
+   {
+      if(repair[i].result == DmtxFail)
+         return DmtxFail;
+   }
+
+   return DmtxPass;
+}
+
+/**
+ * Check interleaved block for errors in place.
+ * \param code
+ * \param sizeIdx
+ * \param blockIdx
+ * \return Are error(s) present? (DmtxTrue|DmtxFalse)
+ */
+static DmtxBoolean
+RsBlockHasErrors(const unsigned char *code, int sizeIdx, int blockIdx)
+{
+   int i;
+   int blockStride, blockDataWords, blockErrorWords, symbolDataWords;
+   DmtxByte syn[MAX_ERROR_WORD_COUNT+1];
+
+   blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
+   blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
+   symbolDataWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, sizeIdx);
+
+   /* Data word count depends on blockIdx due to special case at 144x144 */
+   blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
+
+   /* Compute syndromes (syn) directly from the symbol's codewords */
+   memset(syn, 0x00, sizeof(syn));
+   RsAccumulateSyndromes(syn, blockErrorWords, code + blockIdx, blockDataWords, blockStride);
+   RsAccumulateSyndromes(syn, blockErrorWords, code + symbolDataWords + blockIdx, blockErrorWords, blockStride);
+
+   for(i = 1; i <= blockErrorWords; i++)
+   {
+      if(syn[i] != 0)
+         return DmtxTrue;
+   }
+
+   return DmtxFalse;
+}
+
+/**
+ * Repair one block from a task runner.
+ * \param arg DmtxRsBlock describing block, which receives the result
+ * \return void
+ */
+static void
+RsRepairBlockTask(void *arg)
+{
+   DmtxRsBlock *block = (DmtxRsBlock *)arg;
+
+   block->result = RsRepairBlock(block->code, block->erasure, block->sizeIdx, block->blockIdx);
+}
+
+/**
+ * Repair interleaved block containing errors.
+ * When erasure flags are provided, a block with flagged codewords is first
+ * repaired as errors and erasures, which corrects up to twice as many
+ * codewords whose locations are already known. Blocks without flags, or
+ * where that repair fails, are repaired as errors only. Only codewords of
+ * this block are read or written.
+ * \param code
+ * \param erasure Flags marking unreliable codewords (nonzero), or NULL
+ * \param sizeIdx
+ * \param blockIdx
  * \return Function success (DmtxPass|DmtxFail)
  */
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxFail; }
 static DmtxPassFail
-RsDecode(unsigned char *code, int sizeIdx, int fix)
+RsRepairBlock(unsigned char *code, const unsigned char *erasure, int sizeIdx, int blockIdx)
 {
    int i;
-   int blockStride, blockIdx;
+   int blockStride;
    int blockDataWords, blockErrorWords, blockMaxCorrectable;
-//   int blockDataWords, blockErrorWords, blockTotalWords, blockMaxCorrectable;
    int symbolDataWords, symbolErrorWords, symbolTotalWords;
+   int eraCount;
    DmtxBoolean error, repairable;
    DmtxPassFail passFail;
    unsigned char *word;
@@ -162,10 +401,13 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
    DmtxByte synStorage[MAX_ERROR_WORD_COUNT+1];
    DmtxByte recStorage[NN];
    DmtxByte locStorage[NN];
+   DmtxByte eraStorage[NN];
+   DmtxByte eraWeight[NN];
    DmtxByteList elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
    DmtxByteList syn = dmtxByteListBuild(synStorage, sizeof(synStorage));
    DmtxByteList rec = dmtxByteListBuild(recStorage, sizeof(recStorage));
    DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
+   DmtxByteList era = dmtxByteListBuild(eraStorage, sizeof(eraStorage));
 
    blockStride = dmtxGetSymbolAttribute(DmtxSymAttribInterleavedBlocks, sizeIdx);
    blockErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribBlockErrorWords, sizeIdx);
@@ -174,71 +416,81 @@ RsDecode(unsigned char *code, int sizeIdx, int fix)
    symbolErrorWords = dmtxGetSymbolAttribute(DmtxSymAttribSymbolErrorWords, sizeIdx);
    symbolTotalWords = symbolDataWords + symbolErrorWords;
 
-   /* For each interleaved block */
-   for(blockIdx = 0; blockIdx < blockStride; blockIdx++)
-   {
-      /* Data word count depends on blockIdx due to special case at 144x144 */
-      blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
-//      blockTotalWords = blockErrorWords + blockDataWords;
-
-      /* Populate received list (rec) with data and error codewords */
-      dmtxByteListInit(&rec, 0, 0, &passFail); CHKPASS;
+   /* Data word count depends on blockIdx due to special case at 144x144 */
+   blockDataWords = dmtxGetBlockDataSize(sizeIdx, blockIdx);
 
-      /* Start with final error word and work backward */
-      word = code + symbolTotalWords + blockIdx - blockStride;
-      for(i = 0; i < blockErrorWords; i++)
-      {
-         dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
-         word -= blockStride;
-      }
+   /* Populate received list (rec) with data and error codewords, and
+      erasure list (era) with positions of flagged codewords in rec */
+   dmtxByteListInit(&rec, 0, 0, &passFail); CHKPASS;
+   dmtxByteListInit(&era, 0, 0, &passFail); CHKPASS;
 
-      /* Start with final data word and work backward */
-      word = code + blockIdx + (blockStride * (blockDataWords - 1));
-      for(i = 0; i < blockDataWords; i++)
-      {
-         dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
-         word -= blockStride;
-      }
+   /* Start with final error word and work backward */
+   word = code + symbolTotalWords + blockIdx - blockStride;
+   for(i = 0; i < blockErrorWords; i++)
+   {
+      if(erasure != NULL && erasure[word - code] != 0)
+         RsAddErasure(&era, eraWeight, rec.length, erasure[word - code]);
+      dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
+      word -= blockStride;
+   }
 
-      /* Compute syndromes (syn) */
-      error = RsComputeSyndromes(&syn, &rec, blockErrorWords);
+   /* Start with final data word and work backward */
+   word = code + blockIdx + (blockStride * (blockDataWords - 1));
+   for(i = 0; i < blockDataWords; i++)
+   {
+      if(erasure != NULL && erasure[word - code] != 0)
+         RsAddErasure(&era, eraWeight, rec.length, erasure[word - code]);
+      dmtxByteListPush(&rec, *word, &passFail); CHKPASS;
+      word -= blockStride;
+   }
 
-      /* Error(s) detected: Attempt repair */
-      if(error)
-      {
-         /* Find error locator polynomial (elp) */
-         repairable = RsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
-         if(!repairable)
-            return DmtxFail;
+   /* Compute syndromes (syn) */
+   error = RsComputeSyndromes(&syn, &rec, blockErrorWords);
 
-         /* Find error positions (loc) */
-         repairable = RsFindErrorLocations(&loc, &elp);
-         if(!repairable)
-            return DmtxFail;
+   /* Known erasures leave room for more repairs than errors alone. Start
+      with the least certain codewords, halving their count on failure. */
+   eraCount = min(era.length, 2 * blockMaxCorrectable - ERASURE_CHECK_WORDS);
+   for(; error && eraCount > 0; eraCount /= 2)
+   {
+      era.length = eraCount;
+      error = !RsRepairErrata(&rec, &syn, &era, blockErrorWords, blockMaxCorrectable);
+   }
 
-         /* Find error values and repair */
-         RsRepairErrors(&rec, &loc, &elp, &syn);
-      }
+   /* Error(s) detected: Attempt repair */
+   if(error)
+   {
+      /* Find error locator polynomial (elp) */
+      repairable = RsFindErrorLocatorPoly(&elp, &syn, blockErrorWords, blockMaxCorrectable);
+      if(!repairable)
+         return DmtxFail;
+
+      /* Find error positions (loc) */
+      repairable = RsFindErrorLocations(&loc, &elp, rec.length);
+      if(!repairable)
+         return DmtxFail;
+
+      /* Find error values and repair */
+      RsRepairErrors(&rec, &loc, &elp, &syn);
+   }
 
-      /*
-       * Overwrite output with correct/corrected values
-       */
+   /*
+    * Overwrite output with correct/corrected values
+    */
 
-      /* Start with first data word and work forward */
-      word = code + blockIdx;
-      for(i = 0; i < blockDataWords; i++)
-      {
-         *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
-         word += blockStride;
-      }
+   /* Start with first data word and work forward */
+   word = code + blockIdx;
+   for(i = 0; i < blockDataWords; i++)
+   {
+      *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
+      word += blockStride;
+   }
 
-      /* Start with first error word and work forward */
-      word = code + symbolDataWords + blockIdx;
-      for(i = 0; i < blockErrorWords; i++)
-      {
-         *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
-         word += blockStride;
-      }
+   /* Start with first error word and work forward */
+   word = code + symbolDataWords + blockIdx;
+   for(i = 0; i < blockErrorWords; i++)
+   {
+      *word = dmtxByteListPop(&rec, &passFail); CHKPASS;
+      word += blockStride;
    }
 
    return DmtxPass;
@@ -293,20 +545,20 @@ RsGenPoly(DmtxByteList *gen, int errorWordCount)
 static DmtxBoolean
 RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords)
 {
-   int i, j;
+   int i;
    DmtxPassFail passFail;
    DmtxBoolean error = DmtxFalse;
 
    /* Initialize all coefficients to 0 */
    dmtxByteListInit(syn, blockErrorWords + 1, 0, &passFail); CHKPASS;
 
+   /* Highest order received word comes first */
+   if(rec->length > 0)
+      RsAccumulateSyndromes(syn->b, blockErrorWords, rec->b + rec->length - 1, rec->length, -1);
+
+   /* Non-zero syndrome indicates presence of error(s) */
    for(i = 1; i < syn->length; i++)
    {
-      /* Calculate syndrome at i */
-      for(j = 0; j < rec->length; j++) /* alternatively: j < blockTotalWords */
-         syn->b[i] = GfAdd(syn->b[i], GfMultAntilog(rec->b[j], i*j));
-
-      /* Non-zero syndrome indicates presence of error(s) */
       if(syn->b[i] != 0)
          error = DmtxTrue;
    }
@@ -314,6 +566,31 @@ RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWor
    return error;
 }
 
+/**
+ * Feed received words into syndromes using Horner's rule.
+ * Every syndrome alpha**i, i=1..synCount, is updated for each word, so words
+ * are read once in order of decreasing power and exponents never exceed
+ * synCount. Words are located by stride, letting interleaved codewords be
+ * read directly from the symbol.
+ * \param syn Syndrome values, with syn[0] unused
+ * \param synCount
+ * \param word Highest order word
+ * \param wordCount
+ * \param stride Distance between successive words
+ * \return void
+ */
+static void
+RsAccumulateSyndromes(DmtxByte *syn, int synCount, const unsigned char *word, int wordCount, int stride)
+{
+   int i, j;
+
+   for(j = 0; j < wordCount; j++, word += stride)
+   {
+      for(i = 1; i <= synCount; i++)
+         syn[i] = GfAdd(GfMultAntilog(syn[i], i), *word);
+   }
+}
+
 /**
  * Find the error location polynomial using Berlekamp-Massey.
  * More detailed description.
@@ -397,22 +674,187 @@ RsFindErrorLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, int errorW
    return (lambda <= maxCorrectable) ? DmtxTrue : DmtxFalse;
 }
 
+/**
+ * Add erasure position, keeping least certain codewords first.
+ * \param era Erasure positions within received list
+ * \param eraWeight Unsure module count of each listed erasure
+ * \param position
+ * \param flags Unsure module bits of codeword
+ * \return void
+ */
+static void
+RsAddErasure(DmtxByteList *era, DmtxByte *eraWeight, int position, int flags)
+{
+   int i, weight;
+
+   for(weight = 0; flags != 0; flags &= flags - 1)
+      weight++;
+
+   for(i = era->length; i > 0 && eraWeight[i-1] < weight; i--)
+   {
+      era->b[i] = era->b[i-1];
+      eraWeight[i] = eraWeight[i-1];
+   }
+
+   era->b[i] = position;
+   eraWeight[i] = weight;
+   era->length++;
+}
+
+/**
+ * Find the errata locator polynomial using Berlekamp-Massey seeded with the
+ * erasure locator. Starting from the product of (1 + alpha**p x) over the
+ * erasure positions p, only the syndromes not consumed by erasures are
+ * needed to locate the remaining errors. A block is repairable when twice
+ * the error count plus the erasure count stays within twice the number of
+ * correctable errors, less ERASURE_CHECK_WORDS so the repair is verified
+ * by at least one syndrome it didn't consume.
+ * \param elpOut
+ * \param syn
+ * \param era Erasure positions within received list
+ * \param errorWordCount
+ * \param maxCorrectable
+ * \return Is block repairable? (DmtxTrue|DmtxFalse)
+ */
+#undef CHKPASS
+#define CHKPASS { if(passFail == DmtxFail) return DmtxFalse; }
+static DmtxBoolean
+RsFindErrataLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, const DmtxByteList *era, int errorWordCount, int maxCorrectable)
+{
+   int i, j, k;
+   int cLength, bLength, tLength;
+   DmtxPassFail passFail;
+   DmtxByte dis, disInv;
+   DmtxByte c[MAX_ERROR_WORD_COUNT+2], b[MAX_ERROR_WORD_COUNT+2], t[MAX_ERROR_WORD_COUNT+2];
+
+   if(era->length > errorWordCount)
+      return DmtxFalse;
+
+   /* Erasure locator becomes both current (c) and previous (b) polynomial */
+   memset(c, 0x00, sizeof(c));
+   c[0] = 1;
+   cLength = 1;
+   for(i = 0; i < era->length; i++, cLength++)
+   {
+      for(j = cLength; j > 0; j--)
+         c[j] = GfAdd(c[j], GfMultAntilog(c[j-1], era->b[i]));
+   }
+   memcpy(b, c, sizeof(b));
+   bLength = cLength;
+
+   for(k = era->length + 1; k <= errorWordCount; k++)
+   {
+      /* Calculate discrepancy at syndrome k */
+      for(dis = syn->b[k], j = 1; j < cLength && j < k; j++)
+         dis = GfAdd(dis, GfMult(c[j], syn->b[k-j]));
+
+      /* Shift previous polynomial (b = x * b) */
+      for(j = bLength; j > 0; j--)
+         b[j] = b[j-1];
+      b[0] = 0;
+      bLength++;
+
+      if(dis == 0)
+         continue;
+
+      /* Locator length grows: previous becomes c / dis before update */
+      if(bLength > cLength)
+      {
+         disInv = antilog301[NN - log301[dis]];
+         for(j = 0; j < bLength; j++)
+            t[j] = GfMult(b[j], dis);
+         for(j = 0; j < cLength; j++)
+            b[j] = GfMult(c[j], disInv);
+         for(j = cLength; j < bLength; j++)
+            b[j] = 0;
+         memcpy(c, t, bLength);
+         tLength = bLength;
+         bLength = cLength;
+         cLength = tLength;
+      }
+
+      /* c = c + dis * b */
+      for(j = 0; j < bLength; j++)
+         c[j] = GfAdd(c[j], GfMult(b[j], dis));
+      cLength = max(cLength, bLength);
+   }
+
+   while(cLength > 1 && c[cLength-1] == 0)
+      cLength--;
+
+   if(2 * (cLength - 1) - era->length + ERASURE_CHECK_WORDS > 2 * maxCorrectable)
+      return DmtxFalse;
+
+   dmtxByteListInit(elpOut, cLength, 0, &passFail); CHKPASS;
+   memcpy(elpOut->b, c, cLength);
+
+   return DmtxTrue;
+}
+
+/**
+ * Repair errors and erasures in a received block.
+ * Errata locations come from RsFindErrataLocatorPoly() and the Chien search,
+ * and values from the same Forney step used for errors alone. The received
+ * list is only changed if the repaired block has all-zero syndromes.
+ * \param rec
+ * \param syn
+ * \param era Erasure positions within received list
+ * \param errorWordCount
+ * \param maxCorrectable
+ * \return Was block repaired? (DmtxTrue|DmtxFalse)
+ */
+#undef CHKPASS
+#define CHKPASS { if(passFail == DmtxFail) return DmtxFalse; }
+static DmtxBoolean
+RsRepairErrata(DmtxByteList *rec, const DmtxByteList *syn, const DmtxByteList *era, int errorWordCount, int maxCorrectable)
+{
+   DmtxPassFail passFail;
+   DmtxByte elpStorage[MAX_ERROR_WORD_COUNT+2];
+   DmtxByte locStorage[NN];
+   DmtxByte fixStorage[NN];
+   DmtxByte chkStorage[MAX_ERROR_WORD_COUNT+1];
+   DmtxByteList elp = dmtxByteListBuild(elpStorage, sizeof(elpStorage));
+   DmtxByteList loc = dmtxByteListBuild(locStorage, sizeof(locStorage));
+   DmtxByteList fix = dmtxByteListBuild(fixStorage, sizeof(fixStorage));
+   DmtxByteList chk = dmtxByteListBuild(chkStorage, sizeof(chkStorage));
+
+   if(!RsFindErrataLocatorPoly(&elp, syn, era, errorWordCount, maxCorrectable))
+      return DmtxFalse;
+
+   if(!RsFindErrorLocations(&loc, &elp, rec->length))
+      return DmtxFalse;
+
+   /* Repair a copy so a miscorrection leaves received values untouched */
+   dmtxByteListCopy(&fix, rec, &passFail); CHKPASS;
+   RsRepairErrors(&fix, &loc, &elp, syn);
+
+   if(RsComputeSyndromes(&chk, &fix, errorWordCount))
+      return DmtxFalse;
+
+   dmtxByteListCopy(rec, &fix, &passFail); CHKPASS;
+
+   return DmtxTrue;
+}
+
 /**
  * Find roots of the error locator polynomial (Chien Search).
- * If the degree of elp is <= tt, we substitute alpha**i, i=1..n into the elp
- * to get the roots, hence the inverse roots, the error location numbers.
+ * If the degree of elp is <= tt, we substitute alpha**i into the elp to get
+ * the roots, hence the inverse roots, the error location numbers. Only the
+ * alpha**i matching positions inside the block are tried, and the search
+ * ends once every root is found.
  * If the number of errors located does not equal the degree of the elp, we
  * have more than tt errors and cannot correct them.
  * \param loc
  * \param elp
+ * \param wordCount Codewords in block (data and error)
  * \return Is block repairable? (DmtxTrue|DmtxFalse)
  */
 #undef CHKPASS
 #define CHKPASS { if(passFail == DmtxFail) return DmtxFalse; }
 static DmtxBoolean
-RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
+RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp, int wordCount)
 {
-   int i, j;
+   int i, j, power;
    int lambda = elp->length - 1;
    DmtxPassFail passFail;
    DmtxByte q, regStorage[MAX_ERROR_WORD_COUNT];
@@ -421,7 +863,20 @@ RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
    dmtxByteListCopy(&reg, elp, &passFail); CHKPASS;
    dmtxByteListInit(loc, 0, 0, &passFail); CHKPASS;
 
-   for(i = 1; i <= NN; i++)
+   if(wordCount > NN)
+      wordCount = NN;
+
+   /* Position NN - i is tried at alpha**i, so the first position inside the
+      block is at i = NN - wordCount + 1. Start reg[j] at elp[j] * alpha**(j*(i-1)) */
+   for(power = 0, j = 1; j <= lambda; j++)
+   {
+      power += NN - wordCount;
+      if(power >= NN)
+         power -= NN;
+      reg.b[j] = GfMultAntilog(reg.b[j], power);
+   }
+
+   for(i = NN - wordCount + 1; i <= NN && loc->length < lambda; i++)
    {
       for(q = 1, j = 1; j <= lambda; j++)
       {
@@ -457,7 +912,7 @@ RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp)
 static DmtxPassFail
 RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp, const DmtxByteList *syn)
 {
-   int i, j, q;
+   int i, j, q, power;
    int lambda = elp->length - 1;
    DmtxPassFail passFail;
    DmtxByte zVal, root, err;
@@ -478,8 +933,14 @@ RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *e
       /* Calculate numerator of error term */
       root = NN - loc->b[i];
 
-      for(err = 1, j = 1; j <= lambda; j++)
-         err = GfAdd(err, GfMultAntilog(z.b[j], j * root));
+      for(err = 1, power = 0, j = 1; j <= lambda; j++)
+      {
+         /* power = (j * root) mod NN */
+         power += root;
+         if(power >= NN)
+            power -= NN;
+         err = GfAdd(err, GfMultAntilog(z.b[j], power));
+      }
 
       if(err == 0)
          continue;
@@ -488,7 +949,7 @@ RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *e
       for(q = 0, j = 0; j < lambda; j++)
       {
          if(j != i)
-            q += log301[1 ^ antilog301[(loc->b[j] + root) % NN]];
+            q += log301[1 ^ antilog301[loc->b[j] + root]];
       }
       q %= NN;
 
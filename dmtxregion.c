@@ -16,6 +16,8 @@
  */
 
 #define DMTX_HOUGH_RES 180
+#define DMTX_PROFILE_MIN 64
+#define DMTX_PROFILE_MAX 1024
 
 /**
  * \brief  Create copy of existing region struct
@@ -92,31 +94,61 @@ dmtxRegionFindNext(DmtxDecode *dec, DmtxTime *timeout)
  */
 extern DmtxRegion *
 dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
+{
+   DmtxRegion reg;
+
+   if(RegionFindNext(dec, constraint, &reg) == DmtxFail)
+      return NULL;
+
+   return dmtxRegionCreate(&reg);
+}
+
+/**
+ * \brief  Find next barcode region without allocating a region struct
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  constraint Pointer to constraint (NULL if no constraints)
+ * \param  reg Receives detected region
+ * \return DmtxPass if region was found | DmtxFail
+ */
+static DmtxPassFail
+RegionFindNext(DmtxDecode *dec, DmtxScanConstraint *constraint, DmtxRegion *reg)
 {
    int locStatus;
    int iterations = 0;
    DmtxPixelLoc loc;
-   DmtxRegion   *reg;
 
    /* Continue until we find a region or run out of chances */
    for(;;) {
-      locStatus = PopGridLocation(&(dec->grid), &loc);
+      switch(dec->detectMode) {
+         case DmtxDetectHough:
+            locStatus = PopHoughLocation(dec, &loc);
+            break;
+         case DmtxDetectRunLength:
+            locStatus = PopRunLocation(dec, &loc);
+            break;
+         default:
+            locStatus = PopGridLocation(&(dec->grid), &loc);
+            break;
+      }
+
       if(locStatus == DmtxRangeEnd) {
          if(constraint != NULL)
             constraint->stopCause = DmtxScanNotFound;
          break;
       }
 
-      /* Iterations counts the number of calls to ScanPixel */
-      ++iterations;
-      /* Scan location for presence of valid barcode region */
-      reg = dmtxRegionScanPixel(dec, loc.X, loc.Y);
-      if(reg != NULL) {
-         if(constraint != NULL) {
-            constraint->iterations = iterations;
-            constraint->stopCause = DmtxScanSuccess;
+      /* Rejected Hough tiles yield no location but still honor limits */
+      if(locStatus == DmtxRangeGood) {
+         /* Iterations counts the number of calls to ScanPixel */
+         ++iterations;
+         /* Scan location for presence of valid barcode region */
+         if(RegionScanPixel(dec, loc.X, loc.Y, reg) == DmtxPass) {
+            if(constraint != NULL) {
+               constraint->iterations = iterations;
+               constraint->stopCause = DmtxScanSuccess;
+            }
+            return DmtxPass;
          }
-         return reg;
       }
 
       /* Ran out of iterations? */
@@ -134,7 +166,7 @@ dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
    if(constraint)
       constraint->iterations = iterations;
 
-   return NULL;
+   return DmtxFail;
 }
 
 /**
@@ -146,8 +178,27 @@ dmtxRegionFindNextDeterministic(DmtxDecode *dec, DmtxScanConstraint *constraint)
 extern DmtxRegion *
 dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
 {
-   unsigned char *cache;
    DmtxRegion reg;
+
+   if(RegionScanPixel(dec, x, y, &reg) == DmtxFail)
+      return NULL;
+
+   return dmtxRegionCreate(&reg);
+}
+
+/**
+ * \brief  Scan individual pixel without allocating a region struct
+ * \param  dec Pointer to DmtxDecode information struct
+ * \param  x
+ * \param  y
+ * \param  reg Receives detected region
+ * \return DmtxPass if region was found | DmtxFail
+ */
+static DmtxPassFail
+RegionScanPixel(DmtxDecode *dec, int x, int y, DmtxRegion *reg)
+{
+   unsigned char *cache;
+   DmtxBoolean useReject;
    DmtxPointFlow flowBegin;
    DmtxPixelLoc loc;
 
@@ -156,44 +207,70 @@ dmtxRegionScanPixel(DmtxDecode *dec, int x, int y)
 
    cache = dmtxDecodeGetCache(dec, loc.X, loc.Y);
    if(cache == NULL)
-      return NULL;
+      return DmtxFail;
 
    if((int)(*cache & 0x80) != 0x00)
-      return NULL;
+      return DmtxFail;
 
    /* Test for presence of any reasonable edge at this location */
    flowBegin = MatrixRegionSeekEdge(dec, loc);
    if(flowBegin.mag < (int)(dec->edgeThresh * 7.65 + 0.5))
-      return NULL;
+      return DmtxFail;
 
-   memset(&reg, 0x00, sizeof(DmtxRegion));
+   /* Grid probes skip edges already traced from another location. Other
+      detectors seed the same edge at several points on purpose, since a
+      fit that fails from one starting point can succeed from another. */
+   useReject = (dec->detectMode == DmtxDetectTrail) ? DmtxTrue : DmtxFalse;
+   if(useReject == DmtxTrue && RejectCacheTest(dec, flowBegin.loc.X, flowBegin.loc.Y) == DmtxTrue)
+      return DmtxFail;
+
+   memset(reg, 0x00, sizeof(DmtxRegion));
+
+   if(MatrixRegionFit(dec, reg, flowBegin) == DmtxFail) {
+      if(useReject == DmtxTrue)
+         RejectCacheMarkTrail(dec);
+      return DmtxFail;
+   }
+
+   /* Found a valid matrix region */
+   return DmtxPass;
+}
 
+/**
+ * \brief  Fit a region to the edge found at flowBegin
+ * \param  dec
+ * \param  reg
+ * \param  flowBegin
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MatrixRegionFit(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin)
+{
    /* Determine barcode orientation */
-   if(MatrixRegionOrientation(dec, &reg, flowBegin) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionOrientation(dec, reg, flowBegin) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
 
    /* Define top edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeTop) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionAlignCalibEdge(dec, reg, DmtxEdgeTop) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
 
    /* Define right edge */
-   if(MatrixRegionAlignCalibEdge(dec, &reg, DmtxEdgeRight) == DmtxFail)
-      return NULL;
-   if(dmtxRegionUpdateXfrms(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionAlignCalibEdge(dec, reg, DmtxEdgeRight) == DmtxFail)
+      return DmtxFail;
+   if(dmtxRegionUpdateXfrms(dec, reg) == DmtxFail)
+      return DmtxFail;
 
-   CALLBACK_MATRIX(&reg);
+   CALLBACK_MATRIX(reg);
 
    /* Calculate the best fitting symbol size */
-   if(MatrixRegionFindSize(dec, &reg) == DmtxFail)
-      return NULL;
+   if(MatrixRegionFindSize(dec, reg) == DmtxFail)
+      return DmtxFail;
 
-   /* Found a valid matrix region */
-   return dmtxRegionCreate(&reg);
+   return DmtxPass;
 }
 
 /**
@@ -631,47 +708,6 @@ RightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2, double angle)
    return dmtxVector2Dot(&vA, &vB);
 }
 
-/**
- * \brief  Read color of Data Matrix module location
- * \param  dec
- * \param  reg
- * \param  symbolRow
- * \param  symbolCol
- * \param  sizeIdx
- * \return Averaged module color
- */
-static int
-ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
-      int sizeIdx, int colorPlane)
-{
-   int i;
-   int symbolRows, symbolCols;
-   int color, colorTmp;
-   double sampleX[] = { 0.5, 0.4, 0.5, 0.6, 0.5 };
-   double sampleY[] = { 0.5, 0.5, 0.4, 0.5, 0.6 };
-   DmtxVector2 p;
-
-   symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-   symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
-
-   color = 0;
-   for(i = 0; i < 5; i++) {
-
-      p.X = (1.0/symbolCols) * (symbolCol + sampleX[i]);
-      p.Y = (1.0/symbolRows) * (symbolRow + sampleY[i]);
-
-      dmtxMatrix3VMultiplyBy(&p, reg->fit2raw);
-
-      //fprintf(stdout, "%dx%d\n", (int)(p.X + 0.5), (int)(p.Y + 0.5));
-
-      dmtxDecodeGetPixelValue(dec, (int)(p.X + 0.5), (int)(p.Y + 0.5),
-            colorPlane, &colorTmp);
-      color += colorTmp;
-   }
-   //fprintf(stdout, "\n");
-   return color/5;
-}
-
 /**
  * \brief  Determine barcode size, expressed in modules
  * \param  image
@@ -681,15 +717,14 @@ ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol,
 static DmtxPassFail
 MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
 {
-   int row, col;
+   int i;
    int sizeIdxBeg, sizeIdxEnd;
    int sizeIdx, bestSizeIdx;
-   int symbolRows, symbolCols;
-   int jumpCount, errors;
-   int color;
    int colorOnAvg, bestColorOnAvg;
    int colorOffAvg, bestColorOffAvg;
    int contrast, bestContrast;
+   int candidateCount;
+   int candidate[2];
 //   DmtxImage *img;
 
 //   img = dec->image;
@@ -714,37 +749,32 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
       sizeIdxEnd = dec->sizeIdxExpected + 1;
    }
 
-   /* Test each barcode size to find best contrast in calibration modules */
-   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
-
-      symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
-      symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
-      colorOnAvg = colorOffAvg = 0;
+   /* Test sizes nearest to measured module pitch before trying them all */
+   candidateCount = 0;
+   if(sizeIdxEnd - sizeIdxBeg > 2)
+      candidateCount = EstimateSizeCandidates(dec, reg, sizeIdxBeg, sizeIdxEnd, candidate);
 
-      /* Sum module colors along horizontal calibration bar */
-      row = symbolRows - 1;
-      for(col = 0; col < symbolCols; col++) {
-         color = ReadModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
-         if((col & 0x01) != 0x00)
-            colorOffAvg += color;
-         else
-            colorOnAvg += color;
+   for(i = 0; i < candidateCount; i++) {
+      contrast = CalibrationContrast(dec, reg, candidate[i], &colorOnAvg, &colorOffAvg);
+      if(contrast >= 20 && contrast > bestContrast) {
+         bestContrast = contrast;
+         bestSizeIdx = candidate[i];
+         bestColorOnAvg = colorOnAvg;
+         bestColorOffAvg = colorOffAvg;
       }
+   }
 
-      /* Sum module colors along vertical calibration bar */
-      col = symbolCols - 1;
-      for(row = 0; row < symbolRows; row++) {
-         color = ReadModuleColor(dec, reg, row, col, sizeIdx, reg->flowBegin.plane);
-         if((row & 0x01) != 0x00)
-            colorOffAvg += color;
-         else
-            colorOnAvg += color;
-      }
+   if(bestSizeIdx != DmtxUndefined &&
+         MatrixRegionVerifySize(dec, reg, bestSizeIdx, bestColorOnAvg, bestColorOffAvg) == DmtxPass)
+      return DmtxPass;
 
-      colorOnAvg = (colorOnAvg * 2)/(symbolRows + symbolCols);
-      colorOffAvg = (colorOffAvg * 2)/(symbolRows + symbolCols);
+   /* Otherwise test each barcode size to find best contrast in calibration modules */
+   bestSizeIdx = DmtxUndefined;
+   bestContrast = 0;
+   bestColorOnAvg = bestColorOffAvg = 0;
 
-      contrast = abs(colorOnAvg - colorOffAvg);
+   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
+      contrast = CalibrationContrast(dec, reg, sizeIdx, &colorOnAvg, &colorOffAvg);
       if(contrast < 20)
          continue;
 
@@ -760,51 +790,72 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
    if(bestSizeIdx == DmtxUndefined || bestContrast < 20)
       return DmtxFail;
 
-   reg->sizeIdx = bestSizeIdx;
-   reg->onColor = bestColorOnAvg;
-   reg->offColor = bestColorOffAvg;
+   return MatrixRegionVerifySize(dec, reg, bestSizeIdx, bestColorOnAvg, bestColorOffAvg);
+}
+
+/**
+ * \brief  Assign symbol size to region and confirm it by counting module
+ *         transitions along finder and calibration bars
+ * \param  dec
+ * \param  reg
+ * \param  sizeIdx
+ * \param  onColor
+ * \param  offColor
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+MatrixRegionVerifySize(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, int onColor, int offColor)
+{
+   int jumpCount, errors;
+   DmtxModuleSampler sampler;
+
+   reg->sizeIdx = sizeIdx;
+   reg->onColor = onColor;
+   reg->offColor = offColor;
 
    reg->symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, reg->sizeIdx);
    reg->symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, reg->sizeIdx);
    reg->mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, reg->sizeIdx);
    reg->mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, reg->sizeIdx);
 
+   ModuleSamplerInit(&sampler, dec, reg, reg->sizeIdx);
+
    /* Tally jumps on horizontal calibration bar to verify sizeIdx */
-   jumpCount = CountJumpTally(dec, reg, 0, reg->symbolRows - 1, DmtxDirRight);
+   jumpCount = CountJumpTally(&sampler, reg, 0, reg->symbolRows - 1, DmtxDirRight);
    errors = abs(1 + jumpCount - reg->symbolCols);
    if(jumpCount < 0 || errors > 2)
       return DmtxFail;
 
    /* Tally jumps on vertical calibration bar to verify sizeIdx */
-   jumpCount = CountJumpTally(dec, reg, reg->symbolCols - 1, 0, DmtxDirUp);
+   jumpCount = CountJumpTally(&sampler, reg, reg->symbolCols - 1, 0, DmtxDirUp);
    errors = abs(1 + jumpCount - reg->symbolRows);
    if(jumpCount < 0 || errors > 2)
       return DmtxFail;
 
    /* Tally jumps on horizontal finder bar to verify sizeIdx */
-   errors = CountJumpTally(dec, reg, 0, 0, DmtxDirRight);
+   errors = CountJumpTally(&sampler, reg, 0, 0, DmtxDirRight);
    if(jumpCount < 0 || errors > 2)
       return DmtxFail;
 
    /* Tally jumps on vertical finder bar to verify sizeIdx */
-   errors = CountJumpTally(dec, reg, 0, 0, DmtxDirUp);
+   errors = CountJumpTally(&sampler, reg, 0, 0, DmtxDirUp);
    if(errors < 0 || errors > 2)
       return DmtxFail;
 
    /* Tally jumps on surrounding whitespace, else fail */
-   errors = CountJumpTally(dec, reg, 0, -1, DmtxDirRight);
+   errors = CountJumpTally(&sampler, reg, 0, -1, DmtxDirRight);
    if(errors < 0 || errors > 2)
       return DmtxFail;
 
-   errors = CountJumpTally(dec, reg, -1, 0, DmtxDirUp);
+   errors = CountJumpTally(&sampler, reg, -1, 0, DmtxDirUp);
    if(errors < 0 || errors > 2)
       return DmtxFail;
 
-   errors = CountJumpTally(dec, reg, 0, reg->symbolRows, DmtxDirRight);
+   errors = CountJumpTally(&sampler, reg, 0, reg->symbolRows, DmtxDirRight);
    if(errors < 0 || errors > 2)
       return DmtxFail;
 
-   errors = CountJumpTally(dec, reg, reg->symbolCols, 0, DmtxDirUp);
+   errors = CountJumpTally(&sampler, reg, reg->symbolCols, 0, DmtxDirUp);
    if(errors < 0 || errors > 2)
       return DmtxFail;
 
@@ -813,7 +864,7 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
 
 /**
  * \brief  Count the number of number of transitions between light and dark
- * \param  img
+ * \param  sampler Module sampler initialized for reg->sizeIdx
  * \param  reg
  * \param  xStart
  * \param  yStart
@@ -821,7 +872,7 @@ MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg)
  * \return Jump count
  */
 static int
-CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir)
+CountJumpTally(DmtxModuleSampler *sampler, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir)
 {
    int x, xInc = 0;
    int y, yInc = 0;
@@ -846,7 +897,8 @@ CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDir
 
    darkOnLight = (int)(reg->offColor > reg->onColor);
    jumpThreshold = abs((int)(0.4 * (reg->onColor - reg->offColor) + 0.5));
-   color = ReadModuleColor(dec, reg, yStart, xStart, reg->sizeIdx, reg->flowBegin.plane);
+   ModuleSamplerSeek(sampler, yStart, xStart, yInc, xInc);
+   color = ModuleSamplerNext(sampler);
    tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
    for(x = xStart + xInc, y = yStart + yInc;
@@ -855,7 +907,7 @@ CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDir
          x += xInc, y += yInc) {
 
       tPrev = tModule;
-      color = ReadModuleColor(dec, reg, y, x, reg->sizeIdx, reg->flowBegin.plane);
+      color = ModuleSamplerNext(sampler);
       tModule = (darkOnLight) ? reg->offColor - color : color - reg->offColor;
 
       if(state == DmtxModuleOff) {
@@ -875,6 +927,226 @@ CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDir
    return jumpCount;
 }
 
+/**
+ * \brief  Measure contrast between alternating calibration modules for a
+ *         candidate symbol size
+ * \param  dec
+ * \param  reg
+ * \param  sizeIdx
+ * \param  colorOnAvg Average color of even calibration modules
+ * \param  colorOffAvg Average color of odd calibration modules
+ * \return Contrast
+ */
+static int
+CalibrationContrast(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, int *colorOnAvg, int *colorOffAvg)
+{
+   int row, col;
+   int symbolRows, symbolCols;
+   int color, colorOn, colorOff;
+   DmtxModuleSampler sampler;
+
+   ModuleSamplerInit(&sampler, dec, reg, sizeIdx);
+   symbolRows = sampler.symbolRows;
+   symbolCols = sampler.symbolCols;
+   colorOn = colorOff = 0;
+
+   /* Sum module colors along horizontal calibration bar */
+   ModuleSamplerSeek(&sampler, symbolRows - 1, 0, 0, 1);
+   for(col = 0; col < symbolCols; col++) {
+      color = ModuleSamplerNext(&sampler);
+      if((col & 0x01) != 0x00)
+         colorOff += color;
+      else
+         colorOn += color;
+   }
+
+   /* Sum module colors along vertical calibration bar */
+   ModuleSamplerSeek(&sampler, 0, symbolCols - 1, 1, 0);
+   for(row = 0; row < symbolRows; row++) {
+      color = ModuleSamplerNext(&sampler);
+      if((row & 0x01) != 0x00)
+         colorOff += color;
+      else
+         colorOn += color;
+   }
+
+   *colorOnAvg = (colorOn * 2)/(symbolRows + symbolCols);
+   *colorOffAvg = (colorOff * 2)/(symbolRows + symbolCols);
+
+   return abs(*colorOnAvg - *colorOffAvg);
+}
+
+/**
+ * \brief  Pick the symbol sizes whose module counts best match the module
+ *         pitch measured along both calibration bars
+ * \param  dec
+ * \param  reg
+ * \param  sizeIdxBeg First size to consider
+ * \param  sizeIdxEnd One past last size to consider
+ * \param  candidate Receives up to 2 sizes, nearest first
+ * \return Number of candidates found (0 if pitch could not be measured)
+ */
+static int
+EstimateSizeCandidates(DmtxDecode *dec, DmtxRegion *reg, int sizeIdxBeg, int sizeIdxEnd, int candidate[2])
+{
+   int sizeIdx;
+   int count;
+   double colCount, rowCount;
+   double err, bestErr[2];
+   DmtxPassFail colPass, rowPass;
+
+   colPass = EstimateModuleCount(dec, reg, DmtxDirRight, &colCount);
+   rowPass = EstimateModuleCount(dec, reg, DmtxDirUp, &rowCount);
+   if(colPass == DmtxFail && rowPass == DmtxFail)
+      return 0;
+
+   count = 0;
+   bestErr[0] = bestErr[1] = DBL_MAX;
+
+   for(sizeIdx = sizeIdxBeg; sizeIdx < sizeIdxEnd; sizeIdx++) {
+      err = 0.0;
+      if(colPass == DmtxPass)
+         err += fabs(dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx) - colCount)/colCount;
+      if(rowPass == DmtxPass)
+         err += fabs(dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx) - rowCount)/rowCount;
+
+      if(err < bestErr[0]) {
+         bestErr[1] = bestErr[0];
+         candidate[1] = candidate[0];
+         bestErr[0] = err;
+         candidate[0] = sizeIdx;
+         count++;
+      }
+      else if(err < bestErr[1]) {
+         bestErr[1] = err;
+         candidate[1] = sizeIdx;
+         count++;
+      }
+   }
+
+   return min(count, 2);
+}
+
+/**
+ * \brief  Estimate number of modules along a calibration bar from the period
+ *         of a dense intensity profile taken just inside the bar. Profiles are
+ *         taken at several depths since bar thickness depends on the symbol
+ *         size, and the one with the strongest periodicity wins.
+ * \param  dec
+ * \param  reg
+ * \param  dir DmtxDirRight for horizontal bar, DmtxDirUp for vertical bar
+ * \param  moduleCount Estimated module count
+ * \return DmtxPass | DmtxFail
+ */
+static DmtxPassFail
+EstimateModuleCount(DmtxDecode *dec, DmtxRegion *reg, DmtxDirection dir, double *moduleCount)
+{
+   int i, k, d;
+   int n, mean;
+   int lagZero, lagPeak, lagMax;
+   int depth[] = { 288, 72, 24 }; /* Half-module depth of 144, 36, and 12 module bars */
+   int profile[DMTX_PROFILE_MAX];
+   long r, r0, rPeak, rPrev, rNext;
+   double quality, bestQuality, period;
+   DmtxVector2 p0, p1;
+   DmtxModuleSampler sampler;
+
+   assert(dir == DmtxDirRight || dir == DmtxDirUp);
+
+   /* Sample about twice per pixel along the bar */
+   p0.X = (dir == DmtxDirRight) ? 0.0 : 1.0;
+   p0.Y = (dir == DmtxDirRight) ? 1.0 : 0.0;
+   p1.X = p1.Y = 1.0;
+   dmtxMatrix3VMultiplyBy(&p0, reg->fit2raw);
+   dmtxMatrix3VMultiplyBy(&p1, reg->fit2raw);
+   dmtxVector2SubFrom(&p1, &p0);
+
+   n = (int)(2.0 * dmtxVector2Mag(&p1));
+   n = max(n, DMTX_PROFILE_MIN);
+   n = min(n, DMTX_PROFILE_MAX);
+
+   /* Need at least two full periods for the shortest bar (8 modules) */
+   lagMax = n/2;
+
+   bestQuality = 0.0;
+   *moduleCount = 0.0;
+
+   for(d = 0; d < (int)(sizeof(depth)/sizeof(depth[0])); d++) {
+
+      if(dir == DmtxDirRight) {
+         ModuleSamplerInitGrid(&sampler, dec, reg, depth[d], n, 1);
+         ModuleSamplerSeek(&sampler, depth[d] - 1, 0, 0, 1);
+      }
+      else {
+         ModuleSamplerInitGrid(&sampler, dec, reg, n, depth[d], 1);
+         ModuleSamplerSeek(&sampler, 0, depth[d] - 1, 1, 0);
+      }
+
+      mean = 0;
+      for(i = 0; i < n; i++) {
+         profile[i] = ModuleSamplerNext(&sampler);
+         mean += profile[i];
+      }
+      mean /= n;
+
+      r0 = 0;
+      for(i = 0; i < n; i++) {
+         profile[i] -= mean;
+         r0 += profile[i] * profile[i];
+      }
+      if(r0 == 0)
+         continue;
+
+      /* Autocorrelation of a square wave first crosses zero at 1/4 period */
+      lagZero = 0;
+      for(k = 1; k < lagMax && lagZero == 0; k++) {
+         for(r = 0, i = 0; i < n - k; i++)
+            r += profile[i] * profile[i + k];
+         if(r < 0)
+            lagZero = k;
+      }
+      if(lagZero == 0)
+         continue;
+
+      /* Then peaks at one full period */
+      lagPeak = 0;
+      rPeak = 0;
+      for(k = 2 * lagZero; k <= min(6 * lagZero, lagMax); k++) {
+         for(r = 0, i = 0; i < n - k; i++)
+            r += profile[i] * profile[i + k];
+         if(r > rPeak) {
+            rPeak = r;
+            lagPeak = k;
+         }
+      }
+      if(lagPeak == 0)
+         continue;
+
+      quality = ((double)rPeak / r0) * n / (n - lagPeak);
+      if(quality <= bestQuality)
+         continue;
+
+      /* Refine peak location with parabola through neighboring lags */
+      for(rPrev = 0, i = 0; i < n - lagPeak + 1; i++)
+         rPrev += profile[i] * profile[i + lagPeak - 1];
+      for(rNext = 0, i = 0; i < n - lagPeak - 1; i++)
+         rNext += profile[i] * profile[i + lagPeak + 1];
+
+      period = lagPeak;
+      if(rPrev - 2 * rPeak + rNext < 0)
+         period += 0.5 * (rPrev - rNext)/(double)(rPrev - 2 * rPeak + rNext);
+
+      bestQuality = quality;
+      *moduleCount = 2.0 * n / period;
+   }
+
+   /* Weak periodicity means the bar was not found at any depth */
+   if(bestQuality < 0.3)
+      return DmtxFail;
+
+   return DmtxPass;
+}
+
 /**
  *
  *
@@ -1130,6 +1402,8 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
    DmtxPixelLoc boundMin, boundMax;
 
    boundMin = boundMax = flowBegin.loc;
+   RejectCacheBeginTrail(dec, flowBegin.loc);
+
    cacheBeg = dmtxDecodeGetCache(dec, flowBegin.loc.X, flowBegin.loc.Y);
    if(cacheBeg == NULL)
       return DmtxFail;
@@ -1170,6 +1444,7 @@ TrailBlazeContinuous(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin,
          /* If testing upstream (sign > 0) then next downstream is opposite of next arrival */
          *cacheNext = (sign < 0) ? (((flowNext.arrive + 4)%8) << 3) : ((flowNext.arrive + 4)%8);
          *cacheNext |= (0x80 | 0x40); /* Mark location as visited and assigned */
+         RejectCacheAddTrail(dec, flowNext.loc);
          if(sign > 0)
             posAssigns++;
          else
@@ -0,0 +1,649 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxrunlength.c
+ * \brief Run length region detection
+ */
+
+/**
+ * In DmtxDetectRunLength mode the region of interest is binarized with a
+ * single threshold and every row is run length encoded in one sequential
+ * pass. Dark runs that touch runs of the previous row are joined into
+ * connected components, so a printed symbol (its finder, timing pattern and
+ * data modules) collapses into one component whose bounding box is close to
+ * the symbol outline.
+ *
+ * Components are ranked by how much they look like a symbol: a solid side
+ * spanning the box height and a solid run spanning the box width form the L
+ * shaped finder, while many short runs on the opposite sides indicate the
+ * alternating timing pattern. Pixels on the outline of each candidate are
+ * then handed to the usual region fitting in dmtxRegionScanPixel(), which
+ * performs calibration and size detection as for any other seed location.
+ *
+ * Only dark-on-light symbols form components, and ranking assumes symbols
+ * are roughly aligned with the image axes. Rotated symbols are still seeded,
+ * just after the better candidates.
+ */
+
+/**
+ * \brief  Allocate run length scan state
+ * \return Initialized DmtxRunScan struct
+ */
+static DmtxRunScan *
+RunScanCreate(void)
+{
+   DmtxRunScan *scan;
+
+   scan = (DmtxRunScan *)calloc(1, sizeof(DmtxRunScan));
+   if(scan == NULL)
+      return NULL;
+
+   return scan;
+}
+
+/**
+ * \brief  Free run length scan state and pooled buffers
+ * \param  scan
+ * \return void
+ */
+static void
+RunScanDestroy(DmtxRunScan **scan)
+{
+   if(scan == NULL || *scan == NULL)
+      return;
+
+   free((*scan)->seed);
+   free((*scan)->run);
+   free((*scan)->runComponent);
+   free((*scan)->component);
+
+   free(*scan);
+   *scan = NULL;
+}
+
+/**
+ * \brief  Restart run length scan over current image and region of interest
+ * \param  dec
+ * \return void
+ */
+static void
+RunScanReset(DmtxDecode *dec)
+{
+   DmtxRunScan *scan;
+
+   scan = dec->runs;
+   if(scan == NULL)
+      return;
+
+   scan->populated = DmtxFalse;
+   scan->seedIdx = 0;
+   scan->seedCount = 0;
+   scan->runCount = 0;
+   scan->componentCount = 0;
+}
+
+/**
+ * \brief  Return the next seed location, encoding the image on first use
+ * \param  dec
+ * \param  locPtr
+ * \return DmtxRangeGood | DmtxRangeEnd
+ */
+static int
+PopRunLocation(DmtxDecode *dec, DmtxPixelLoc *locPtr)
+{
+   DmtxRunScan *scan;
+
+   if(dec->runs == NULL) {
+      dec->runs = RunScanCreate();
+      if(dec->runs == NULL)
+         return DmtxRangeEnd;
+      RunScanReset(dec);
+   }
+
+   scan = dec->runs;
+
+   if(scan->populated == DmtxFalse) {
+      RunScanPopulate(dec, scan);
+      scan->populated = DmtxTrue;
+   }
+
+   if(scan->seedIdx >= scan->seedCount) {
+      locPtr->X = locPtr->Y = -1;
+      return DmtxRangeEnd;
+   }
+
+   *locPtr = scan->seed[scan->seedIdx++];
+
+   return DmtxRangeGood;
+}
+
+/**
+ * \brief  Run length encode region of interest and collect seed locations
+ *         from candidate components, best candidates first
+ * \param  dec
+ * \param  scan
+ * \return void
+ */
+static void
+RunScanPopulate(DmtxDecode *dec, DmtxRunScan *scan)
+{
+   int i, x, y, x0;
+   int threshold, channel;
+   int prevBeg, prevEnd, rowBeg;
+   int dark;
+   DmtxBoolean byteChannels;
+   DmtxImage *img;
+   DmtxRunComponent *comp;
+
+   img = dec->image;
+
+   for(byteChannels = DmtxTrue, channel = 0; channel < img->channelCount; channel++)
+      if(img->bitsPerChannel[channel] != 8)
+         byteChannels = DmtxFalse;
+
+   threshold = RunScanThreshold(dec, byteChannels);
+   if(threshold == DmtxUndefined)
+      return;
+
+   prevBeg = prevEnd = 0;
+
+   for(y = dec->yMin; y <= dec->yMax; y++) {
+      rowBeg = scan->runCount;
+
+      /* Encode dark runs of this row, reading each pixel once */
+      x0 = DmtxUndefined;
+      for(x = dec->xMin; x <= dec->xMax + 1; x++) {
+         dark = (x <= dec->xMax && RunScanPixel(dec, x, y, byteChannels) < threshold);
+
+         if(dark && x0 == DmtxUndefined) {
+            x0 = x;
+         }
+         else if(!dark && x0 != DmtxUndefined) {
+            if(RunScanAddRun(scan, x0, x - 1, y) == DmtxFail)
+               return;
+            x0 = DmtxUndefined;
+         }
+      }
+
+      /* Join runs that touch a run of the previous row (8-connected). Both
+         rows are ordered by x, so one merge-like walk finds every pair. */
+      i = rowBeg;
+      while(prevBeg < prevEnd && i < scan->runCount) {
+         if(scan->run[prevBeg].x1 + 1 < scan->run[i].x0) {
+            prevBeg++;
+         }
+         else if(scan->run[i].x1 + 1 < scan->run[prevBeg].x0) {
+            i++;
+         }
+         else {
+            RunScanUnion(scan, prevBeg, i);
+            if(scan->run[prevBeg].x1 < scan->run[i].x1)
+               prevBeg++;
+            else
+               i++;
+         }
+      }
+
+      prevBeg = rowBeg;
+      prevEnd = scan->runCount;
+   }
+
+   if(RunScanMeasure(scan) == DmtxFail)
+      return;
+
+   qsort(scan->component, scan->componentCount, sizeof(DmtxRunComponent),
+         RunComponentCompare);
+
+   for(i = 0; i < scan->componentCount; i++) {
+      comp = &(scan->component[i]);
+      if(comp->score != DmtxUndefined)
+         RunScanAddSeeds(scan, comp);
+   }
+}
+
+/**
+ * \brief  Choose a global dark/light threshold with Otsu's method, using a
+ *         sparse sample of the region of interest
+ * \param  dec
+ * \param  byteChannels DmtxTrue if all channels can be read as bytes
+ * \return Threshold, or DmtxUndefined if image has too little contrast
+ */
+static int
+RunScanThreshold(DmtxDecode *dec, DmtxBoolean byteChannels)
+{
+   int x, y, t, value;
+   int lo, hi;
+   int histogram[256];
+   double total, sumAll, sumLo, countLo, countHi;
+   double meanLo, meanHi, between, betweenBest;
+   int thresholdBest;
+
+   memset(histogram, 0x00, sizeof(histogram));
+
+   for(y = dec->yMin; y <= dec->yMax; y += 4) {
+      for(x = dec->xMin; x <= dec->xMax; x += 4) {
+         value = RunScanPixel(dec, x, y, byteChannels);
+         histogram[max(0, min(value, 255))]++;
+      }
+   }
+
+   for(lo = 0; lo < 255 && histogram[lo] == 0; lo++);
+   for(hi = 255; hi > 0 && histogram[hi] == 0; hi--);
+
+   if(hi - lo < DmtxRunContrastMin)
+      return DmtxUndefined;
+
+   total = sumAll = 0.0;
+   for(t = 0; t < 256; t++) {
+      total += histogram[t];
+      sumAll += t * histogram[t];
+   }
+
+   /* Threshold separates values below t from values at or above t */
+   sumLo = countLo = 0.0;
+   betweenBest = -1.0;
+   thresholdBest = (lo + hi + 1)/2;
+   for(t = lo + 1; t <= hi; t++) {
+      countLo += histogram[t-1];
+      sumLo += (t - 1) * histogram[t-1];
+      countHi = total - countLo;
+
+      if(countLo < 1.0 || countHi < 1.0)
+         continue;
+
+      meanLo = sumLo/countLo;
+      meanHi = (sumAll - sumLo)/countHi;
+      between = countLo * countHi * (meanHi - meanLo) * (meanHi - meanLo);
+
+      if(between > betweenBest) {
+         betweenBest = between;
+         thresholdBest = t;
+      }
+   }
+
+   return thresholdBest;
+}
+
+/**
+ * \brief  Read average channel value of a pixel
+ * \param  dec
+ * \param  x Scaled x coordinate
+ * \param  y Scaled y coordinate
+ * \param  byteChannels DmtxTrue if all channels can be read as bytes
+ * \return Average channel value
+ */
+static int
+RunScanPixel(DmtxDecode *dec, int x, int y, DmtxBoolean byteChannels)
+{
+   int channel, channelCount;
+   int offset, sum, value;
+   DmtxImage *img;
+
+   img = dec->image;
+   channelCount = img->channelCount;
+
+   sum = 0;
+   offset = dmtxImageGetByteOffset(img, x * dec->scale, y * dec->scale);
+
+   /* Read byte channels directly rather than one call per channel */
+   if(byteChannels == DmtxTrue && offset != DmtxUndefined) {
+      for(channel = 0; channel < channelCount; channel++)
+         sum += img->pxl[offset + channel];
+   }
+   else {
+      for(channel = 0; channel < channelCount; channel++) {
+         value = 0;
+         dmtxDecodeGetPixelValue(dec, x, y, channel, &value);
+         sum += value;
+      }
+   }
+
+   return sum / channelCount;
+}
+
+/**
+ * \brief  Append a dark run as a new single-run component
+ * \param  scan
+ * \param  x0 First dark pixel
+ * \param  x1 Last dark pixel
+ * \param  y
+ * \return DmtxPass | DmtxFail if run list couldn't grow
+ */
+static DmtxPassFail
+RunScanAddRun(DmtxRunScan *scan, int x0, int x1, int y)
+{
+   int runAlloc;
+   DmtxRun *run;
+
+   if(scan->runCount == scan->runAlloc) {
+      runAlloc = (scan->runAlloc == 0) ? 1024 : scan->runAlloc * 2;
+      run = (DmtxRun *)realloc(scan->run, runAlloc * sizeof(DmtxRun));
+      if(run == NULL)
+         return DmtxFail;
+
+      scan->run = run;
+      scan->runAlloc = runAlloc;
+   }
+
+   run = &(scan->run[scan->runCount]);
+   run->x0 = x0;
+   run->x1 = x1;
+   run->y = y;
+   run->parent = scan->runCount;
+
+   scan->runCount++;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Find the root run of a component, compressing the path on the way
+ * \param  scan
+ * \param  runIdx
+ * \return Index of root run
+ */
+static int
+RunScanFindRoot(DmtxRunScan *scan, int runIdx)
+{
+   DmtxRun *run;
+
+   run = scan->run;
+
+   while(run[runIdx].parent != runIdx) {
+      run[runIdx].parent = run[run[runIdx].parent].parent;
+      runIdx = run[runIdx].parent;
+   }
+
+   return runIdx;
+}
+
+/**
+ * \brief  Join the components of two runs. The lower index always becomes
+ *         the root, so every root comes before the rest of its component.
+ * \param  scan
+ * \param  runIdx0
+ * \param  runIdx1
+ * \return void
+ */
+static void
+RunScanUnion(DmtxRunScan *scan, int runIdx0, int runIdx1)
+{
+   int root0, root1;
+
+   root0 = RunScanFindRoot(scan, runIdx0);
+   root1 = RunScanFindRoot(scan, runIdx1);
+
+   if(root0 < root1)
+      scan->run[root1].parent = root0;
+   else if(root1 < root0)
+      scan->run[root0].parent = root1;
+}
+
+/**
+ * \brief  Gather bounding box, area, and outline statistics of every
+ *         component in two passes over the run list
+ * \param  scan
+ * \return DmtxPass | DmtxFail if component list couldn't grow
+ */
+static DmtxPassFail
+RunScanMeasure(DmtxRunScan *scan)
+{
+   int i, k, root, width, height, len;
+   int *runComponent;
+   DmtxRun *run;
+   DmtxRunComponent *comp;
+
+   if(scan->runCount == 0)
+      return DmtxPass;
+
+   /* Per-run lookup sized for the largest run list seen so far */
+   runComponent = (int *)realloc(scan->runComponent, scan->runAlloc * sizeof(int));
+   if(runComponent == NULL)
+      return DmtxFail;
+   scan->runComponent = runComponent;
+
+   /* Roots precede their components, so one pass assigns and accumulates */
+   scan->componentCount = 0;
+   for(i = 0; i < scan->runCount; i++) {
+      run = &(scan->run[i]);
+      root = RunScanFindRoot(scan, i);
+
+      if(root == i) {
+         if(scan->componentCount == scan->componentAlloc) {
+            k = (scan->componentAlloc == 0) ? 256 : scan->componentAlloc * 2;
+            comp = (DmtxRunComponent *)realloc(scan->component, k * sizeof(DmtxRunComponent));
+            if(comp == NULL)
+               return DmtxFail;
+            scan->component = comp;
+            scan->componentAlloc = k;
+         }
+
+         runComponent[i] = scan->componentCount++;
+         comp = &(scan->component[runComponent[i]]);
+         memset(comp, 0x00, sizeof(DmtxRunComponent));
+         comp->xMin = run->x0;
+         comp->xMax = run->x1;
+         comp->yMin = comp->yMax = run->y;
+      }
+      else {
+         runComponent[i] = runComponent[root];
+         comp = &(scan->component[runComponent[i]]);
+         comp->xMin = min(comp->xMin, run->x0);
+         comp->xMax = max(comp->xMax, run->x1);
+         comp->yMax = run->y;
+      }
+
+      comp->area += run->x1 - run->x0 + 1;
+   }
+
+   for(i = 0; i < scan->componentCount; i++) {
+      comp = &(scan->component[i]);
+      for(k = 0; k < DmtxRunSampleRows; k++) {
+         comp->rowLeft[k] = comp->rowRight[k] = DmtxUndefined;
+         comp->rowMid[k] = DmtxUndefined;
+      }
+   }
+
+   /* Outline statistics depend on the final bounding box */
+   for(i = 0; i < scan->runCount; i++) {
+      run = &(scan->run[i]);
+      comp = &(scan->component[runComponent[i]]);
+      len = run->x1 - run->x0 + 1;
+
+      if(run->x0 <= comp->xMin + 1)
+         comp->edgeLeft++;
+      if(run->x1 >= comp->xMax - 1)
+         comp->edgeRight++;
+
+      if(run->y <= comp->yMin + 1)
+         comp->spanBottom = max(comp->spanBottom, len);
+      if(run->y >= comp->yMax - 1)
+         comp->spanTop = max(comp->spanTop, len);
+
+      if(run->y == comp->yMin)
+         comp->runsBottom++;
+      if(run->y == comp->yMax)
+         comp->runsTop++;
+
+      /* Runs arrive left to right, so the first run of a row is leftmost */
+      height = comp->yMax - comp->yMin;
+      for(k = 0; k < DmtxRunSampleRows; k++) {
+         if(run->y != comp->yMin + (k * height)/(DmtxRunSampleRows - 1))
+            continue;
+
+         if(comp->rowLeft[k] == DmtxUndefined)
+            comp->rowLeft[k] = run->x0;
+         comp->rowRight[k] = run->x1;
+
+         if(len > comp->rowSpan[k]) {
+            comp->rowSpan[k] = len;
+            comp->rowMid[k] = (run->x0 + run->x1)/2;
+         }
+      }
+   }
+
+   for(i = 0; i < scan->componentCount; i++) {
+      comp = &(scan->component[i]);
+      width = comp->xMax - comp->xMin + 1;
+      height = comp->yMax - comp->yMin + 1;
+
+      /* Specks, solid blobs, and thin strokes can't be symbols */
+      if(width < DmtxRunExtentMin || height < DmtxRunExtentMin ||
+            comp->area * 10 < width * height * 2 || comp->area * 10 > width * height * 9)
+         comp->score = DmtxUndefined;
+      else
+         RunComponentScore(comp);
+   }
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Score finder and timing pattern evidence of a component. A solid
+ *         side spanning nearly all of the box (the L finder) is worth 2,
+ *         and a side broken into alternating runs (timing) is worth 1.
+ * \param  comp
+ * \return void
+ */
+static void
+RunComponentScore(DmtxRunComponent *comp)
+{
+   int width, height;
+   int solidLeft, solidRight, solidBottom, solidTop;
+
+   width = comp->xMax - comp->xMin + 1;
+   height = comp->yMax - comp->yMin + 1;
+
+   solidLeft = (comp->edgeLeft * 10 >= height * 9);
+   solidRight = (comp->edgeRight * 10 >= height * 9);
+   solidBottom = (comp->spanBottom * 10 >= width * 9);
+   solidTop = (comp->spanTop * 10 >= width * 9);
+
+   comp->score = 0;
+
+   if(solidLeft || solidRight)
+      comp->score += 2;
+   if(solidBottom || solidTop)
+      comp->score += 2;
+
+   /* Timing runs the length of the side opposite each solid finder bar */
+   if((solidLeft && !solidRight && comp->edgeRight * 10 < height * 7) ||
+         (solidRight && !solidLeft && comp->edgeLeft * 10 < height * 7))
+      comp->score++;
+   if((solidBottom && !solidTop && comp->runsTop >= 3) ||
+         (solidTop && !solidBottom && comp->runsBottom >= 3))
+      comp->score++;
+}
+
+/**
+ * \brief  Order components by descending score, then descending area
+ * \param  a
+ * \param  b
+ * \return Comparison result for qsort()
+ */
+static int
+RunComponentCompare(const void *a, const void *b)
+{
+   const DmtxRunComponent *compA, *compB;
+
+   compA = (const DmtxRunComponent *)a;
+   compB = (const DmtxRunComponent *)b;
+
+   if(compA->score != compB->score)
+      return (compA->score > compB->score) ? -1 : 1;
+
+   if(compA->area != compB->area)
+      return (compA->area > compB->area) ? -1 : 1;
+
+   return 0;
+}
+
+/**
+ * \brief  Add seed locations along the outline of a candidate component.
+ *         Left and right sides are seeded at interior sample rows, bottom
+ *         and top at the middle of their longest run, and solid sides
+ *         (likely finder bars) go first.
+ * \param  scan
+ * \param  comp
+ * \return void
+ */
+static void
+RunScanAddSeeds(DmtxRunScan *scan, DmtxRunComponent *comp)
+{
+   int k, pass, y;
+   int width, height;
+   DmtxBoolean solid[4];
+
+   width = comp->xMax - comp->xMin + 1;
+   height = comp->yMax - comp->yMin + 1;
+
+   solid[0] = (comp->edgeLeft * 10 >= height * 9) ? DmtxTrue : DmtxFalse;
+   solid[1] = (comp->spanBottom * 10 >= width * 9) ? DmtxTrue : DmtxFalse;
+   solid[2] = (comp->edgeRight * 10 >= height * 9) ? DmtxTrue : DmtxFalse;
+   solid[3] = (comp->spanTop * 10 >= width * 9) ? DmtxTrue : DmtxFalse;
+
+   for(pass = 0; pass < 2; pass++) {
+      /* First pass takes solid sides, second pass takes the rest */
+      if(solid[0] == (pass == 0 ? DmtxTrue : DmtxFalse)) {
+         for(k = 1; k < DmtxRunSampleRows - 1; k++) {
+            y = comp->yMin + (k * (height - 1))/(DmtxRunSampleRows - 1);
+            if(comp->rowLeft[k] != DmtxUndefined)
+               RunScanAddSeed(scan, comp->rowLeft[k], y);
+         }
+      }
+
+      if(solid[1] == (pass == 0 ? DmtxTrue : DmtxFalse) && comp->rowMid[0] != DmtxUndefined)
+         RunScanAddSeed(scan, comp->rowMid[0], comp->yMin);
+
+      if(solid[2] == (pass == 0 ? DmtxTrue : DmtxFalse)) {
+         for(k = 1; k < DmtxRunSampleRows - 1; k++) {
+            y = comp->yMin + (k * (height - 1))/(DmtxRunSampleRows - 1);
+            if(comp->rowRight[k] != DmtxUndefined)
+               RunScanAddSeed(scan, comp->rowRight[k], y);
+         }
+      }
+
+      if(solid[3] == (pass == 0 ? DmtxTrue : DmtxFalse) &&
+            comp->rowMid[DmtxRunSampleRows - 1] != DmtxUndefined)
+         RunScanAddSeed(scan, comp->rowMid[DmtxRunSampleRows - 1], comp->yMax);
+   }
+}
+
+/**
+ * \brief  Append a seed location
+ * \param  scan
+ * \param  x
+ * \param  y
+ * \return DmtxPass | DmtxFail if seed list couldn't grow
+ */
+static DmtxPassFail
+RunScanAddSeed(DmtxRunScan *scan, int x, int y)
+{
+   int seedAlloc;
+   DmtxPixelLoc *seed;
+
+   if(scan->seedCount == scan->seedAlloc) {
+      seedAlloc = (scan->seedAlloc == 0) ? 256 : scan->seedAlloc * 2;
+      seed = (DmtxPixelLoc *)realloc(scan->seed, seedAlloc * sizeof(DmtxPixelLoc));
+      if(seed == NULL)
+         return DmtxFail;
+
+      scan->seed = seed;
+      scan->seedAlloc = seedAlloc;
+   }
+
+   scan->seed[scan->seedCount].X = x;
+   scan->seed[scan->seedCount].Y = y;
+   scan->seedCount++;
+
+   return DmtxPass;
+}
@@ -0,0 +1,268 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxsample.c
+ * \brief Module color sampling
+ */
+
+/**
+ * Module centers are sampled by walking the symbol in module steps. Because
+ * fit2raw is a projective transform, the homogeneous coordinates (X, Y, W)
+ * of a point are linear in its row and column. Moving one module is then a
+ * matter of adding a precomputed step, and each sample point needs only one
+ * divide by W instead of a full matrix multiply.
+ *
+ * When built with HAVE_FIXED_POINT_SAMPLING the per-module walk uses 32.32
+ * fixed point integers and sample locations are resolved in 16.16, leaving
+ * floating point arithmetic only in the once-per-region setup. Region
+ * fitting itself always stays in double precision.
+ *
+ * In DmtxSampleBilinear mode each sub-sample is interpolated from the four
+ * surrounding pixels rather than rounded to the nearest one, which keeps
+ * module reads stable when modules are only a pixel or two wide.
+ */
+
+/**
+ * \brief  Prepare sampler for reading modules of a given symbol size
+ * \param  sampler
+ * \param  dec
+ * \param  reg Region providing fit2raw and color plane
+ * \param  sizeIdx
+ * \return void
+ */
+static void
+ModuleSamplerInit(DmtxModuleSampler *sampler, DmtxDecode *dec, DmtxRegion *reg, int sizeIdx)
+{
+   ModuleSamplerInitGrid(sampler, dec, reg,
+         dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx),
+         dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx), 5);
+}
+
+/**
+ * \brief  Prepare sampler for reading an arbitrary grid laid over the region
+ * \param  sampler
+ * \param  dec
+ * \param  reg Region providing fit2raw and color plane
+ * \param  rows Grid rows spanning the region
+ * \param  cols Grid columns spanning the region
+ * \param  sampleCount 5 for the standard module pattern, 1 for center only
+ * \return void
+ */
+static void
+ModuleSamplerInitGrid(DmtxModuleSampler *sampler, DmtxDecode *dec, DmtxRegion *reg,
+      int rows, int cols, int sampleCount)
+{
+   int i, k;
+   double colScale, rowScale;
+   double colStep[3], rowStep[3];
+   double norm;
+   double sampleX[] = { 0.5, 0.4, 0.5, 0.6, 0.5 };
+   double sampleY[] = { 0.5, 0.5, 0.4, 0.5, 0.6 };
+
+   assert(sampleCount == 1 || sampleCount == 5);
+
+   sampler->dec = dec;
+   sampler->colorPlane = reg->flowBegin.plane;
+   sampler->sampleMode = dec->sampleMode;
+   sampler->sampleCount = sampleCount;
+   sampler->symbolRows = rows;
+   sampler->symbolCols = cols;
+
+   colScale = 1.0/cols;
+   rowScale = 1.0/rows;
+
+   for(k = 0; k < 3; k++) {
+      colStep[k] = colScale * reg->fit2raw[0][k];
+      rowStep[k] = rowScale * reg->fit2raw[1][k];
+   }
+
+#ifdef HAVE_FIXED_POINT_SAMPLING
+   /* Scale homogeneous coordinates so W is near 1 across the symbol, which
+      keeps the fixed point range centered on pixel coordinates */
+   norm = reg->fit2raw[2][2] + 0.5 * (reg->fit2raw[0][2] + reg->fit2raw[1][2]);
+   norm = (fabs(norm) > DmtxAlmostZero) ? 1.0/norm : 1.0;
+#else
+   norm = 1.0;
+#endif
+
+   for(k = 0; k < 3; k++) {
+      sampler->colStep[k] = ModuleSamplerCoord(colStep[k], norm);
+      sampler->rowStep[k] = ModuleSamplerCoord(rowStep[k], norm);
+      sampler->origin[k] = ModuleSamplerCoord(reg->fit2raw[2][k], norm);
+   }
+
+   /* Sub-sample pattern expressed as offsets from the module corner */
+   for(i = 0; i < sampleCount; i++) {
+      for(k = 0; k < 3; k++) {
+         sampler->offset[i][k] = ModuleSamplerCoord(sampleX[i] * colStep[k] +
+               sampleY[i] * rowStep[k], norm);
+      }
+   }
+
+   ModuleSamplerSeek(sampler, 0, 0, 0, 1);
+}
+
+/**
+ * \brief  Position sampler at a module and set direction of travel
+ * \param  sampler
+ * \param  symbolRow
+ * \param  symbolCol
+ * \param  rowInc Rows advanced by each call to ModuleSamplerNext()
+ * \param  colInc Columns advanced by each call to ModuleSamplerNext()
+ * \return void
+ */
+static void
+ModuleSamplerSeek(DmtxModuleSampler *sampler, int symbolRow, int symbolCol, int rowInc, int colInc)
+{
+   int k;
+
+   for(k = 0; k < 3; k++) {
+      sampler->point[k] = sampler->origin[k] + symbolRow * sampler->rowStep[k] +
+            symbolCol * sampler->colStep[k];
+      sampler->step[k] = rowInc * sampler->rowStep[k] + colInc * sampler->colStep[k];
+   }
+}
+
+/**
+ * \brief  Read color of current module and advance to the next one
+ * \param  sampler
+ * \return Average color of module sub-samples
+ */
+static int
+ModuleSamplerNext(DmtxModuleSampler *sampler)
+{
+   int i;
+   int color, colorTmp;
+   DmtxPassFail interpolated;
+   DmtxSampleCoord *point, *offset;
+#ifdef HAVE_FIXED_POINT_SAMPLING
+   long long w, x, y;
+#else
+   double w, wInv;
+   double x, y;
+#endif
+
+   point = sampler->point;
+
+   color = colorTmp = 0;
+   for(i = 0; i < sampler->sampleCount; i++) {
+      offset = sampler->offset[i];
+
+      /* Points that fall off the image repeat the previous sample */
+      w = point[2] + offset[2];
+#ifdef HAVE_FIXED_POINT_SAMPLING
+      if(w > DmtxSampleFixedAlmostZero || w < -DmtxSampleFixedAlmostZero) {
+         /* Quotient is the 16.16 pixel location, rounded as (int)(p + 0.5) */
+         x = ((point[0] + offset[0]) * 65536) / w;
+         y = ((point[1] + offset[1]) * 65536) / w;
+
+         interpolated = DmtxFail;
+         if(sampler->sampleMode == DmtxSampleBilinear)
+            interpolated = ModuleSamplerBilinear(sampler, x, y, &colorTmp);
+
+         if(interpolated == DmtxFail)
+            dmtxDecodeGetPixelValue(sampler->dec, (int)((x + 32768) / 65536),
+                  (int)((y + 32768) / 65536), sampler->colorPlane, &colorTmp);
+      }
+#else
+      if(fabs(w) > DmtxAlmostZero) {
+         wInv = 1.0/w;
+         x = (point[0] + offset[0]) * wInv;
+         y = (point[1] + offset[1]) * wInv;
+
+         interpolated = DmtxFail;
+         if(sampler->sampleMode == DmtxSampleBilinear && fabs(x) < 32768.0 && fabs(y) < 32768.0)
+            interpolated = ModuleSamplerBilinear(sampler, (long long)(x * 65536.0),
+                  (long long)(y * 65536.0), &colorTmp);
+
+         if(interpolated == DmtxFail)
+            dmtxDecodeGetPixelValue(sampler->dec, (int)(x + 0.5), (int)(y + 0.5),
+                  sampler->colorPlane, &colorTmp);
+      }
+#endif
+      color += colorTmp;
+   }
+
+   point[0] += sampler->step[0];
+   point[1] += sampler->step[1];
+   point[2] += sampler->step[2];
+
+   return color/sampler->sampleCount;
+}
+
+/**
+ * \brief  Interpolate pixel value at a sub-pixel location. Each pair of
+ *         neighboring pixels is read from one row offset, so only a single
+ *         bounds check is needed for all four reads.
+ * \param  sampler
+ * \param  x16 X location in 16.16 fixed point (pixel centers at integers)
+ * \param  y16 Y location in 16.16 fixed point (pixel centers at integers)
+ * \param  value Interpolated channel value
+ * \return DmtxPass | DmtxFail if location can't be interpolated
+ */
+static DmtxPassFail
+ModuleSamplerBilinear(DmtxModuleSampler *sampler, long long x16, long long y16, int *value)
+{
+   int x, y, fx, fy;
+   int offset, xStep, yStep;
+   int top, bottom;
+   int scale;
+   unsigned char *pxl;
+   DmtxImage *img;
+
+   img = sampler->dec->image;
+   scale = sampler->dec->scale;
+
+   if(x16 < 0 || y16 < 0 || img->bitsPerChannel[sampler->colorPlane] != 8)
+      return DmtxFail;
+
+   x = (int)(x16 >> 16);
+   y = (int)(y16 >> 16);
+   fx = (int)((x16 >> 8) & 0xff);
+   fy = (int)((y16 >> 8) & 0xff);
+
+   offset = dmtxImageGetByteOffset(img, x * scale, y * scale);
+   if(offset == DmtxUndefined ||
+         dmtxImageContainsInt(img, 0, (x + 1) * scale, (y + 1) * scale) == DmtxFalse)
+      return DmtxFail;
+
+   /* Unflipped images store rows bottom-up, so the next row comes first */
+   xStep = scale * img->bytesPerPixel;
+   yStep = scale * img->rowSizeBytes;
+   if(!(img->imageFlip & DmtxFlipY))
+      yStep = -yStep;
+
+   pxl = img->pxl + offset + sampler->colorPlane;
+
+   top = pxl[0] * (256 - fx) + pxl[xStep] * fx;
+   bottom = pxl[yStep] * (256 - fx) + pxl[yStep + xStep] * fx;
+
+   *value = (top * (256 - fy) + bottom * fy + 32768) >> 16;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Convert homogeneous coordinate to sampler representation
+ * \param  value
+ * \param  norm Scale factor applied before conversion
+ * \return Coordinate in sampler units
+ */
+static DmtxSampleCoord
+ModuleSamplerCoord(double value, double norm)
+{
+#ifdef HAVE_FIXED_POINT_SAMPLING
+   return (DmtxSampleCoord)floor(value * norm * (double)(1LL << DmtxSampleFixedBits) + 0.5);
+#else
+   return value * norm;
+#endif
+}
@@ -50,9 +50,23 @@
 #define DmtxC40TextShift2              2
 #define DmtxC40TextShift3              3
 
+/* Decoder table entries that act on state instead of producing output */
+#define DmtxC40TextNoOutput           -1
+#define DmtxC40TextToShift1           -2
+#define DmtxC40TextToShift2           -3
+#define DmtxC40TextToShift3           -4
+#define DmtxC40TextUpperShift         -5
+#define DmtxC40TextFnc1               -6
+
 #define DmtxUnlatchExplicit            0
 #define DmtxUnlatchImplicit            1
 
+/* Most input words any symbol can hold, as digit pairs filling 144x144 */
+#define DmtxEncodeInputMax          3116
+
+/* Input words past a chunk's end that end-of-symbol checks may read */
+#define DmtxEncodeLookahead            8
+
 #define DmtxChannelValid            0x00
 #define DmtxChannelUnsupportedChar  0x01 << 0
 #define DmtxChannelCannotUnlatch    0x01 << 1
@@ -124,20 +138,332 @@ typedef struct DmtxBresLine_struct {
    DmtxPixelLoc    loc1;
 } DmtxBresLine;
 
-typedef struct C40TextState_struct {
-   int             shift;
-   DmtxBoolean     upperShift;
-} C40TextState;
+#define DmtxModuleUnsureMargin      0.20 /* Tally ratio distance from 0.5 marking module unsure */
+
+/* Module sampling coordinates are either double or 32.32 fixed point */
+#ifdef HAVE_FIXED_POINT_SAMPLING
+#define DmtxSampleFixedBits           32
+#define DmtxSampleFixedAlmostZero     4295 /* DmtxAlmostZero in fixed point */
+typedef long long DmtxSampleCoord;
+#else
+typedef double DmtxSampleCoord;
+#endif
+
+/**
+ * @struct DmtxModuleSampler
+ * @brief DmtxModuleSampler
+ */
+typedef struct DmtxModuleSampler_struct {
+   DmtxDecode     *dec;
+   int             colorPlane;
+   int             sampleMode;
+   int             sampleCount;   /* Sub-samples averaged per module */
+   int             symbolRows;
+   int             symbolCols;
+   DmtxSampleCoord origin[3];     /* Homogeneous coordinates of symbol origin */
+   DmtxSampleCoord colStep[3];    /* Change in homogeneous coordinates per column */
+   DmtxSampleCoord rowStep[3];    /* Change in homogeneous coordinates per row */
+   DmtxSampleCoord offset[5][3];  /* Sub-sample pattern relative to module corner */
+   DmtxSampleCoord point[3];      /* Current module corner */
+   DmtxSampleCoord step[3];       /* Increment applied after each module read */
+} DmtxModuleSampler;
+
+/**
+ * @struct DmtxRsBlock
+ * @brief DmtxRsBlock
+ */
+typedef struct DmtxRsBlock_struct {
+   unsigned char  *code;          /* Codewords of whole symbol */
+   const unsigned char *erasure;  /* Erasure flags of whole symbol, or NULL */
+   int             sizeIdx;
+   int             blockIdx;      /* Interleaved block to repair */
+   DmtxPassFail    result;
+} DmtxRsBlock;
+
+/**
+ * @struct DmtxEncodeStep
+ * @brief DmtxEncodeStep
+ */
+typedef struct DmtxEncodeStep_struct {
+   int             prev;          /* Step this chunk continued from, or DmtxUndefined */
+   int             scheme;
+   int             option;
+} DmtxEncodeStep;
+
+/**
+ * @struct DmtxInputRun
+ * @brief DmtxInputRun
+ */
+typedef struct DmtxInputRun_struct {
+   DmtxByte        digitRun;      /* Digits starting here, capped at 255 */
+   DmtxByte        x12Run;        /* X12 values other than FNC1, capped at 255 */
+   DmtxByte        edifactRun;    /* Values 32-94, capped at 255 */
+   DmtxByte        c40Count;      /* C40 values this input expands to */
+   DmtxByte        textCount;     /* Text values this input expands to */
+   DmtxByte        x12Count;      /* X12 values this input expands to */
+} DmtxInputRun;
+
+/**
+ * @struct DmtxEncodeTrail
+ * @brief DmtxEncodeTrail
+ */
+typedef struct DmtxEncodeTrail_struct {
+   int             count;
+   int             capacity;
+   DmtxEncodeStep *step;
+   DmtxInputRun   *run;           /* Classification of each input word */
+   int             reach;         /* Furthest input word reached by any chunk */
+} DmtxEncodeTrail;
+
+/**
+ * @struct DmtxEncodeState
+ * @brief DmtxEncodeState
+ */
+typedef struct DmtxEncodeState_struct {
+   DmtxEncodeStream stream;       /* Output points to list below */
+   DmtxByteList    output;        /* Real length, words in shared scratch */
+   int             step;          /* Last chunk encoded, or DmtxUndefined */
+} DmtxEncodeState;
+
+enum SchemeState {
+   AsciiFull,
+   AsciiCompactOffset0, /* 0 offset from first regular input value */
+   AsciiCompactOffset1,
+   C40Offset0,          /* 0 offset from first expanded C40 value */
+   C40Offset1,
+   C40Offset2,
+   TextOffset0,         /* 0 offset from first expanded Text value */
+   TextOffset1,
+   TextOffset2,
+   X12Offset0,          /* 0 offset from first expanded X12 value */
+   X12Offset1,
+   X12Offset2,
+   EdifactOffset0,      /* 0 offset from first regular input value */
+   EdifactOffset1,
+   EdifactOffset2,
+   EdifactOffset3,
+   Base256,
+   SchemeStateCount
+};
+
+/**
+ * @struct DmtxEncodeSearch
+ * @brief DmtxEncodeSearch
+ */
+typedef struct DmtxEncodeSearch_struct {
+   int             inputNext;     /* Next input word to advance all states over */
+   int             c40ValueCount; /* C40 values expanded from words before inputNext */
+   int             textValueCount;
+   int             x12ValueCount;
+   DmtxEncodeState statesBest[SchemeStateCount];
+   DmtxEncodeState statesTemp[SchemeStateCount];
+} DmtxEncodeSearch;
+
+/**
+ * @struct DmtxEncodePrefix
+ * @brief DmtxEncodePrefix
+ */
+struct DmtxEncodePrefix_struct {
+   int             sizeIdxRequest;
+   int             fnc1;
+   int             length;        /* Count of prefix words */
+   DmtxByte       *b;             /* Copy of prefix words */
+   int             stepCount;
+   DmtxEncodeStep *step;          /* Trail recorded before search.inputNext */
+   DmtxEncodeSearch search;       /* Search paused where suffix can't matter yet */
+};
+
+#define DmtxHoughLocalSize            64 /* Tile extent screened by Hough detector */
+#define DmtxHoughPhiExtent           128 /* Line angle buckets spanning 180 degrees */
+#define DmtxHoughAngleSortMax          4
+#define DmtxHoughSeedMax              32
+
+typedef enum {
+   DmtxEdgeVertical,
+   DmtxEdgeBackslash,
+   DmtxEdgeHorizontal,
+   DmtxEdgeSlash
+} DmtxEdgeType;
+
+/**
+ * @struct DmtxValueGrid
+ * @brief DmtxValueGrid
+ */
+typedef struct DmtxValueGrid_struct DmtxValueGrid;
+struct DmtxValueGrid_struct {
+   int             width;
+   int             height;
+   int             type;          /* DmtxEdgeType, or direction of derivative */
+   int            *value;
+   DmtxValueGrid  *ref;           /* Sobel grid that an accel grid derives from */
+};
+
+/**
+ * @struct DmtxZeroCrossing
+ * @brief DmtxZeroCrossing
+ */
+typedef struct DmtxZeroCrossing_struct {
+   int             mag;
+   int             x;             /* Tile location in 1/256 pixel units */
+   int             y;
+} DmtxZeroCrossing;
+
+/**
+ * @struct DmtxHoughLocal
+ * @brief DmtxHoughLocal
+ */
+typedef struct DmtxHoughLocal_struct {
+   int             xOrigin;
+   int             yOrigin;
+   int             bucket[DmtxHoughPhiExtent][DmtxHoughLocalSize]; /* [phi][d] */
+} DmtxHoughLocal;
+
+/**
+ * @struct DmtxHoughBucket
+ * @brief DmtxHoughBucket
+ */
+typedef struct DmtxHoughBucket_struct {
+   int             phi;
+   int             d;
+   int             val;
+} DmtxHoughBucket;
+
+/**
+ * @struct DmtxHoughAngleSort
+ * @brief DmtxHoughAngleSort
+ */
+typedef struct DmtxHoughAngleSort_struct {
+   int             count;
+   DmtxHoughBucket bucket[DmtxHoughAngleSortMax];
+} DmtxHoughAngleSort;
+
+/**
+ * @struct DmtxTiming
+ * @brief DmtxTiming
+ */
+typedef struct DmtxTiming_struct {
+   int             phi;
+   double          shift;
+   double          period;
+   double          mag;           /* Share of periodic energy at best period */
+} DmtxTiming;
+
+/**
+ * @struct DmtxHoughScan
+ * @brief DmtxHoughScan
+ */
+typedef struct DmtxHoughScan_struct {
+   /* reset for each image or region of interest */
+   int             tileCols;      /* Tiles spanning region of interest */
+   int             tileRows;
+   int             tileIdx;       /* Next tile to be screened */
+   int             seedIdx;       /* Next seed to hand out from current tile */
+   int             seedCount;
+   DmtxPixelLoc    seed[DmtxHoughSeedMax];
+
+   /* pooled scratch buffers, reused for every tile */
+   DmtxValueGrid  *pixel;
+   DmtxValueGrid  *sobel[4];      /* Indexed by DmtxEdgeType */
+   DmtxValueGrid  *accel[6];
+   DmtxHoughLocal  line;
+   DmtxHoughLocal  maxima;
+
+   /* set once */
+   int             phiCos[DmtxHoughPhiExtent]; /* Compacted line offset terms */
+   int             phiSin[DmtxHoughPhiExtent];
+   int             phiShift[DmtxHoughPhiExtent];
+   double          dftCos[DmtxHoughLocalSize];
+   double          dftSin[DmtxHoughLocalSize];
+} DmtxHoughScan;
+
+#define DmtxRunContrastMin            20 /* Minimum spread between dark and light levels */
+#define DmtxRunExtentMin               8 /* Minimum candidate width and height in pixels */
+#define DmtxRunSampleRows              5 /* Rows sampled for seeds across each candidate */
+
+/**
+ * @struct DmtxRun
+ * @brief DmtxRun
+ */
+typedef struct DmtxRun_struct {
+   int             x0;            /* First dark pixel */
+   int             x1;            /* Last dark pixel */
+   int             y;
+   int             parent;        /* Union-find link to run with lower index */
+} DmtxRun;
+
+/**
+ * @struct DmtxRunComponent
+ * @brief DmtxRunComponent
+ */
+typedef struct DmtxRunComponent_struct {
+   int             xMin;
+   int             xMax;
+   int             yMin;
+   int             yMax;
+   int             area;          /* Dark pixel count */
+   int             edgeLeft;      /* Rows whose dark pixels reach bounding box side */
+   int             edgeRight;
+   int             spanBottom;    /* Longest run on bounding box bottom or top */
+   int             spanTop;
+   int             runsBottom;    /* Runs on bottom and top rows */
+   int             runsTop;
+   int             score;         /* Finder and timing evidence, higher is better */
+   int             rowLeft[DmtxRunSampleRows];  /* Leftmost dark pixel of sampled rows */
+   int             rowRight[DmtxRunSampleRows]; /* Rightmost dark pixel of sampled rows */
+   int             rowMid[DmtxRunSampleRows];   /* Middle of longest run of sampled rows */
+   int             rowSpan[DmtxRunSampleRows];
+} DmtxRunComponent;
+
+/**
+ * @struct DmtxRunScan
+ * @brief DmtxRunScan
+ */
+typedef struct DmtxRunScan_struct {
+   /* reset for each image or region of interest */
+   DmtxBoolean     populated;     /* Image has been run length encoded */
+   int             seedIdx;       /* Next seed to hand out */
+   int             seedCount;
+   int             runCount;
+   int             componentCount;
+
+   /* pooled buffers, grown as needed */
+   int             seedAlloc;
+   DmtxPixelLoc   *seed;
+   int             runAlloc;
+   DmtxRun        *run;
+   int            *runComponent;  /* Component index of each root run */
+   int             componentAlloc;
+   DmtxRunComponent *component;
+} DmtxRunScan;
+
+/**
+ * @struct DmtxRejectCache
+ * @brief DmtxRejectCache
+ */
+typedef struct DmtxRejectCache_struct {
+   int             width;         /* Scaled image dimensions covered by bits */
+   int             height;
+   unsigned char  *bits;          /* One bit per pixel, set along rejected edge trails */
+   int             trailCount;
+   int             trailAlloc;
+   DmtxPixelLoc   *trail;         /* Locations of most recent continuous trail */
+} DmtxRejectCache;
 
 /* dmtxregion.c */
 static double RightAngleTrueness(DmtxVector2 c0, DmtxVector2 c1, DmtxVector2 c2, double angle);
 static DmtxPointFlow MatrixRegionSeekEdge(DmtxDecode *dec, DmtxPixelLoc loc0);
+static DmtxPassFail RegionFindNext(DmtxDecode *dec, DmtxScanConstraint *constraint, DmtxRegion *reg);
+static DmtxPassFail RegionScanPixel(DmtxDecode *dec, int x, int y, DmtxRegion *reg);
+static DmtxPassFail MatrixRegionFit(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin);
 static DmtxPassFail MatrixRegionOrientation(DmtxDecode *dec, DmtxRegion *reg, DmtxPointFlow flowBegin);
 static long DistanceSquared(DmtxPixelLoc a, DmtxPixelLoc b);
-static int ReadModuleColor(DmtxDecode *dec, DmtxRegion *reg, int symbolRow, int symbolCol, int sizeIdx, int colorPlane);
 
 static DmtxPassFail MatrixRegionFindSize(DmtxDecode *dec, DmtxRegion *reg);
-static int CountJumpTally(DmtxDecode *dec, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir);
+static DmtxPassFail MatrixRegionVerifySize(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, int onColor, int offColor);
+static int CountJumpTally(DmtxModuleSampler *sampler, DmtxRegion *reg, int xStart, int yStart, DmtxDirection dir);
+static int CalibrationContrast(DmtxDecode *dec, DmtxRegion *reg, int sizeIdx, /*@out@*/ int *colorOnAvg, /*@out@*/ int *colorOffAvg);
+static int EstimateSizeCandidates(DmtxDecode *dec, DmtxRegion *reg, int sizeIdxBeg, int sizeIdxEnd, /*@out@*/ int candidate[2]);
+static DmtxPassFail EstimateModuleCount(DmtxDecode *dec, DmtxRegion *reg, DmtxDirection dir, /*@out@*/ double *moduleCount);
 static DmtxPointFlow GetPointFlow(DmtxDecode *dec, int colorPlane, DmtxPixelLoc loc, int arrive);
 static DmtxPointFlow FindStrongestNeighbor(DmtxDecode *dec, DmtxPointFlow center, int sign);
 static DmtxFollow FollowSeek(DmtxDecode *dec, DmtxRegion *reg, int seek);
@@ -157,14 +483,27 @@ static DmtxPassFail BresLineStep(DmtxBresLine *line, int travel, int outward);
 /*static void WriteDiagnosticImage(DmtxDecode *dec, DmtxRegion *reg, char *imagePath);*/
 
 /* dmtxdecode.c */
-static void TallyModuleJumps(DmtxDecode *dec, DmtxRegion *reg, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir);
+static void SampleModuleColors(DmtxDecode *dec, DmtxRegion *reg, int *moduleColor);
+static void TallyModuleJumps(DmtxRegion *reg, int *moduleColor, int tally[][24], int xOrigin, int yOrigin, int mapWidth, int mapHeight, DmtxDirection dir);
+static DmtxPassFail DecodeMatrixRegion(DmtxDecode *dec, DmtxRegion *reg, int fix, DmtxMessage *msg);
+static DmtxPassFail DecodePopulatedArray(DmtxDecode *dec, int sizeIdx, DmtxMessage *msg, int fix);
+static unsigned char *FindErasedCodewords(int sizeIdx, DmtxMessage *msg);
 static DmtxPassFail PopulateArrayFromMatrix(DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg);
+static void RejectCacheDestroy(DmtxRejectCache **reject);
+static void RejectCacheReset(DmtxDecode *dec);
+static void RejectCacheBeginTrail(DmtxDecode *dec, DmtxPixelLoc loc);
+static void RejectCacheAddTrail(DmtxDecode *dec, DmtxPixelLoc loc);
+static void RejectCacheMarkTrail(DmtxDecode *dec);
+static DmtxBoolean RejectCacheTest(DmtxDecode *dec, int x, int y);
+
+/* dmtxmessage.c */
+static DmtxResultList *ResultListCreate(void);
+static DmtxPassFail ResultListAdd(DmtxResultList *results, DmtxDecode *dec, DmtxRegion *reg, DmtxMessage *msg);
 
 /* dmtxdecodescheme.c */
 static DmtxPassFail DecodeDataStream(DmtxMessage *msg, int sizeIdx, unsigned char *outputStart);
 static int GetEncodationScheme(unsigned char cw);
 static void PushOutputWord(DmtxMessage *msg, int value);
-static void PushOutputC40TextWord(DmtxMessage *msg, C40TextState *state, int value);
 static void PushOutputMacroHeader(DmtxMessage *msg, int macroType);
 static void PushOutputMacroTrailer(DmtxMessage *msg);
 static unsigned char *DecodeSchemeAscii(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
@@ -174,11 +513,12 @@ static unsigned char *DecodeSchemeEdifact(DmtxMessage *msg, unsigned char *ptr,
 static unsigned char *DecodeSchemeBase256(DmtxMessage *msg, unsigned char *ptr, unsigned char *dataEnd);
 
 /* dmtxencode.c */
+static DmtxPassFail EncodeSymbolImage(DmtxEncode *enc, DmtxByteList *output, int sizeIdx, int padCount);
 static void PrintPattern(DmtxEncode *encode);
 #ifdef HAVE_READER_PROGRAMMING
-    static int EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, DmtxBoolean bReaderProgramming);
+    static int EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount, DmtxBoolean bReaderProgramming);
 #else
-    static int EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1);
+    static int EncodeDataCodewords(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount);
 #endif
 
 /* dmtxplacemod.c */
@@ -193,11 +533,19 @@ static void PlaceModule(unsigned char *modules, int mappingRows, int mappingCols
 
 /* dmtxreedsol.c */
 static DmtxPassFail RsEncode(DmtxMessage *message, int sizeIdx);
-static DmtxPassFail RsDecode(unsigned char *code, int sizeIdx, int fix);
+static DmtxByte *RsFindGenPolyLog(int errorWordCount);
+static DmtxPassFail RsDecode(unsigned char *code, const unsigned char *erasure, int sizeIdx, int fix, DmtxRunTasks runTasks, void *context);
+static DmtxBoolean RsBlockHasErrors(const unsigned char *code, int sizeIdx, int blockIdx);
+static void RsRepairBlockTask(void *arg);
+static DmtxPassFail RsRepairBlock(unsigned char *code, const unsigned char *erasure, int sizeIdx, int blockIdx);
 static DmtxPassFail RsGenPoly(DmtxByteList *gen, int errorWordCount);
 static DmtxBoolean RsComputeSyndromes(DmtxByteList *syn, const DmtxByteList *rec, int blockErrorWords);
+static void RsAccumulateSyndromes(DmtxByte *syn, int synCount, const unsigned char *word, int wordCount, int stride);
 static DmtxBoolean RsFindErrorLocatorPoly(DmtxByteList *elp, const DmtxByteList *syn, int errorWordCount, int maxCorrectable);
-static DmtxBoolean RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp);
+static void RsAddErasure(DmtxByteList *era, DmtxByte *eraWeight, int position, int flags);
+static DmtxBoolean RsFindErrataLocatorPoly(DmtxByteList *elpOut, const DmtxByteList *syn, const DmtxByteList *era, int errorWordCount, int maxCorrectable);
+static DmtxBoolean RsRepairErrata(DmtxByteList *rec, const DmtxByteList *syn, const DmtxByteList *era, int errorWordCount, int maxCorrectable);
+static DmtxBoolean RsFindErrorLocations(DmtxByteList *loc, const DmtxByteList *elp, int wordCount);
 static DmtxPassFail RsRepairErrors(DmtxByteList *rec, const DmtxByteList *loc, const DmtxByteList *elp, const DmtxByteList *syn);
 
 /* dmtxscangrid.c */
@@ -206,6 +554,53 @@ static int PopGridLocation(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
 static int GetGridCoordinates(DmtxScanGrid *grid, /*@out@*/ DmtxPixelLoc *locPtr);
 static void SetDerivedFields(DmtxScanGrid *grid);
 
+/* dmtxsample.c */
+static void ModuleSamplerInit(DmtxModuleSampler *sampler, DmtxDecode *dec, DmtxRegion *reg, int sizeIdx);
+static void ModuleSamplerInitGrid(DmtxModuleSampler *sampler, DmtxDecode *dec, DmtxRegion *reg, int rows, int cols, int sampleCount);
+static void ModuleSamplerSeek(DmtxModuleSampler *sampler, int symbolRow, int symbolCol, int rowInc, int colInc);
+static int ModuleSamplerNext(DmtxModuleSampler *sampler);
+static DmtxPassFail ModuleSamplerBilinear(DmtxModuleSampler *sampler, long long x16, long long y16, /*@out@*/ int *value);
+static DmtxSampleCoord ModuleSamplerCoord(double value, double norm);
+
+/* dmtxhough.c */
+static DmtxHoughScan *HoughScanCreate(void);
+static void HoughScanDestroy(DmtxHoughScan **scan);
+static void HoughScanReset(DmtxDecode *dec);
+static int PopHoughLocation(DmtxDecode *dec, /*@out@*/ DmtxPixelLoc *locPtr);
+static DmtxPassFail HoughScreenTile(DmtxDecode *dec, DmtxHoughScan *scan);
+static DmtxValueGrid *ValueGridCreate(int width, int height, int type, DmtxValueGrid *ref);
+static void ValueGridDestroy(DmtxValueGrid **valueGrid);
+static void PixelPopulate(DmtxDecode *dec, DmtxHoughScan *scan);
+static void SobelPopulate(DmtxHoughScan *scan);
+static void AccelPopulate(DmtxHoughScan *scan);
+static int LineHoughAccumulate(DmtxDecode *dec, DmtxHoughScan *scan);
+static int SobelDominantType(DmtxHoughScan *scan, int x, int y);
+static DmtxZeroCrossing GetZeroCrossing(DmtxValueGrid *accel, int x, int y, int edgeThresh);
+static int HoughGetLocalOffset(DmtxHoughScan *scan, int x, int y, int phi);
+static void MaximaHoughAccumulate(DmtxHoughLocal *maxima, DmtxHoughLocal *line);
+static int GetMaximaWeight(DmtxHoughLocal *line, int phi, int d);
+static DmtxHoughAngleSort FindDominantAngles(DmtxHoughLocal *maxima);
+static void AddToAngleSort(DmtxHoughAngleSort *sort, DmtxHoughBucket bucket);
+static DmtxTiming FindGridTiming(DmtxHoughScan *scan, int phi);
+static void AddLineSeeds(DmtxDecode *dec, DmtxHoughScan *scan, int phi, int d);
+
+/* dmtxrunlength.c */
+static DmtxRunScan *RunScanCreate(void);
+static void RunScanDestroy(DmtxRunScan **scan);
+static void RunScanReset(DmtxDecode *dec);
+static int PopRunLocation(DmtxDecode *dec, /*@out@*/ DmtxPixelLoc *locPtr);
+static void RunScanPopulate(DmtxDecode *dec, DmtxRunScan *scan);
+static int RunScanThreshold(DmtxDecode *dec, DmtxBoolean byteChannels);
+static int RunScanPixel(DmtxDecode *dec, int x, int y, DmtxBoolean byteChannels);
+static DmtxPassFail RunScanAddRun(DmtxRunScan *scan, int x0, int x1, int y);
+static int RunScanFindRoot(DmtxRunScan *scan, int runIdx);
+static void RunScanUnion(DmtxRunScan *scan, int runIdx0, int runIdx1);
+static DmtxPassFail RunScanMeasure(DmtxRunScan *scan);
+static void RunComponentScore(DmtxRunComponent *comp);
+static int RunComponentCompare(const void *a, const void *b);
+static void RunScanAddSeeds(DmtxRunScan *scan, DmtxRunComponent *comp);
+static DmtxPassFail RunScanAddSeed(DmtxRunScan *scan, int x, int y);
+
 /* dmtxsymbol.c */
 static int FindSymbolSize(int dataWords, int sizeIdxRequest);
 
@@ -214,12 +609,10 @@ static int GetBitsPerPixel(int pack);
 
 /* dmtxencodestream.c */
 static DmtxEncodeStream StreamInit(DmtxByteList *input, DmtxByteList *output);
-static void StreamCopy(DmtxEncodeStream *dst, DmtxEncodeStream *src);
 static void StreamMarkComplete(DmtxEncodeStream *stream, int sizeIdx);
 static void StreamMarkInvalid(DmtxEncodeStream *stream, int reasonIdx);
 static void StreamMarkFatal(DmtxEncodeStream *stream, int reasonIdx);
 static void StreamOutputChainAppend(DmtxEncodeStream *stream, DmtxByte value);
-static DmtxByte StreamOutputChainRemoveLast(DmtxEncodeStream *stream);
 static void StreamOutputSet(DmtxEncodeStream *stream, int index, DmtxByte value);
 static DmtxBoolean StreamInputHasNext(DmtxEncodeStream *stream);
 static DmtxByte StreamInputPeekNext(DmtxEncodeStream *stream);
@@ -228,9 +621,9 @@ static void StreamInputAdvancePrev(DmtxEncodeStream *stream);
 
 /* dmtxencodescheme.c */
 #ifdef HAVE_READER_PROGRAMMING
-    static int EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, DmtxBoolean bReaderProgramming);
+    static int EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount, DmtxBoolean bReaderProgramming);
 #else
-    static int EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1);
+    static int EncodeSingleScheme(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, DmtxScheme scheme, int fnc1, int *padCount);
 #endif
 
 static void EncodeNextChunk(DmtxEncodeStream *stream, int scheme, int subScheme, int sizeIdxRequest);
@@ -238,17 +631,36 @@ static void EncodeChangeScheme(DmtxEncodeStream *stream, DmtxScheme targetScheme
 static int GetRemainingSymbolCapacity(int outputLength, int sizeIdx);
 
 /* dmtxencodeoptimize.c */
-static int EncodeOptimizeBest(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1);
-static void StreamAdvanceFromBest(DmtxEncodeStream *streamNext,
-      DmtxEncodeStream *streamList, int targeteState, int sizeIdxRequest);
-static void AdvanceAsciiCompact(DmtxEncodeStream *streamNext, DmtxEncodeStream *streamList,
-      int state, int inputNext, int sizeIdxRequest);
-static void AdvanceCTX(DmtxEncodeStream *streamNext, DmtxEncodeStream *streamList,
-      int state, int inputNext, int ctxValueCount, int sizeIdxRequest);
-static void AdvanceEdifact(DmtxEncodeStream *streamNext, DmtxEncodeStream *streamList,
-      int state, int inputNext, int sizeIdxRequest);
+static int EncodeOptimizeBest(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount);
+static int EncodeOptimizeBestPrefixed(DmtxEncodePrefix *prefix, DmtxByteList *input, DmtxByteList *output, int *padCount);
+static DmtxPassFail EncodeOptimizePrefix(DmtxEncodePrefix *prefix);
+static int EncodeSearchFinish(DmtxEncodeSearch *search, DmtxEncodeTrail *trail, DmtxByteList *input,
+      DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount);
+static void EncodeSearchInit(DmtxEncodeSearch *search, DmtxByteList *input, DmtxByte *scratch, int capacity, int fnc1);
+static void EncodeSearchRebind(DmtxEncodeSearch *search, DmtxByteList *input, DmtxByte *scratch, int capacity);
+static void EncodeSearchAdvance(DmtxEncodeSearch *search, int sizeIdxRequest, DmtxEncodeTrail *trail);
+static void EncodeStateInit(DmtxEncodeState *state, DmtxByteList *input, DmtxByte *scratch, int capacity, int fnc1);
+static void EncodeStateCopy(DmtxEncodeState *dst, DmtxEncodeState *src);
+static void EncodeTrailPush(DmtxEncodeTrail *trail, DmtxEncodeState *state, int scheme, int option);
+static void EncodeTrailReach(DmtxEncodeTrail *trail, DmtxEncodeState *state);
+static int EncodeTrailReplay(DmtxEncodeTrail *trail, int last, DmtxByteList *input,
+      DmtxByteList *output, int sizeIdxRequest, int fnc1);
+static void ClassifyInputRuns(DmtxInputRun *run, DmtxByteList *input, int fnc1);
+static DmtxBoolean ChunkCantEncode(DmtxEncodeState *from, int targetState, DmtxInputRun *run);
+static void StreamAdvanceFromBest(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int targetState, int sizeIdxRequest, DmtxEncodeTrail *trail);
+static void AdvanceAsciiCompact(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int state, int inputNext, int sizeIdxRequest, DmtxEncodeTrail *trail);
+static void AdvanceCTX(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int state, int inputNext, int ctxValueCount, int sizeIdxRequest, DmtxEncodeTrail *trail);
+static void AdvanceEdifact(DmtxEncodeState *statesNext, DmtxEncodeState *statesBest,
+      int state, int inputNext, int sizeIdxRequest, DmtxEncodeTrail *trail);
 static int GetScheme(int state);
 static DmtxBoolean ValidStateSwitch(int fromState, int targetState);
+static int EncodeAutoFast(DmtxByteList *input, DmtxByteList *output, int sizeIdxRequest, int fnc1, int *padCount);
+static DmtxScheme NextSchemeFast(DmtxEncodeStream *stream);
+static DmtxScheme LookAheadTest(DmtxByteList *input, int inputNext, DmtxScheme currentScheme, int fnc1);
+static DmtxBoolean IsNativeValue(int value, DmtxScheme scheme, int fnc1);
 
 /* dmtxencodeascii.c */
 static void EncodeNextChunkAscii(DmtxEncodeStream *stream, int option);
@@ -278,6 +690,7 @@ static void CompleteIfDoneEdifact(DmtxEncodeStream *stream, int sizeIdxRequest);
 /* dmtxencodebase256.c */
 static void EncodeNextChunkBase256(DmtxEncodeStream *stream);
 static void AppendValueBase256(DmtxEncodeStream *stream, DmtxByte value);
+static DmtxPassFail EncodeBase256Run(DmtxEncodeStream *stream, int sizeIdxRequest);
 static void CompleteIfDoneBase256(DmtxEncodeStream *stream, int sizeIdxRequest);
 static void UpdateBase256ChainHeader(DmtxEncodeStream *stream, int perfectSizeIdx);
 static void Base256OutputChainInsertFirst(DmtxEncodeStream *stream);
@@ -0,0 +1,182 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file dmtxverify.c
+ * \brief Expected content verification
+ */
+
+/**
+ * When the printed content is known in advance, a found region can be
+ * checked against the module pattern that content must produce instead of
+ * being decoded. dmtxVerifyCreate() encodes the expected message once and
+ * keeps the state of every symbol module, finder and timing patterns
+ * included. dmtxVerifyRegion() then samples the region and compares module
+ * by module, skipping Reed-Solomon correction and data stream decoding.
+ */
+
+/**
+ * \brief  Build expected module pattern for a message
+ * \param  enc Encoder providing scheme, size request, and FNC1 settings
+ * \param  inputSize
+ * \param  inputString
+ * \return Address of allocated memory, or NULL if message can't be encoded
+ */
+extern DmtxVerify *
+dmtxVerifyCreate(DmtxEncode *enc, int inputSize, unsigned char *inputString)
+{
+   int sizeIdx, padCount;
+   int symbolRow, symbolCol;
+   DmtxByte outputStorage[4096];
+   DmtxByteList output = dmtxByteListBuild(outputStorage, sizeof(outputStorage));
+   DmtxByteList input = dmtxByteListBuild(inputString, inputSize);
+   DmtxMessage *msg;
+   DmtxVerify *verify;
+
+   if(enc == NULL || inputString == NULL)
+      return NULL;
+
+   input.length = inputSize;
+
+   /* Same codewords, error correction, and placement as dmtxEncodeDataMatrix() */
+#ifdef HAVE_READER_PROGRAMMING
+   sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount, DmtxFalse);
+#else
+   sizeIdx = EncodeDataCodewords(&input, &output, enc->sizeIdxRequest, enc->scheme, enc->fnc1, &padCount);
+#endif
+   if(sizeIdx == DmtxUndefined || output.length <= 0)
+      return NULL;
+
+   msg = dmtxMessageCreate(sizeIdx, DmtxFormatMatrix);
+   if(msg == NULL)
+      return NULL;
+
+   memcpy(msg->code, output.b, output.length);
+   RsEncode(msg, sizeIdx);
+   ModulePlacementEcc200(msg->array, msg->code, sizeIdx, DmtxModuleOnRGB);
+
+   verify = (DmtxVerify *)calloc(1, sizeof(DmtxVerify));
+   if(verify == NULL) {
+      dmtxMessageDestroy(&msg);
+      return NULL;
+   }
+
+   verify->sizeIdx = sizeIdx;
+   verify->symbolRows = dmtxGetSymbolAttribute(DmtxSymAttribSymbolRows, sizeIdx);
+   verify->symbolCols = dmtxGetSymbolAttribute(DmtxSymAttribSymbolCols, sizeIdx);
+
+   verify->module = (unsigned char *)malloc(verify->symbolRows * verify->symbolCols);
+   verify->moduleColor = (int *)malloc(verify->symbolRows * verify->symbolCols * sizeof(int));
+   if(verify->module == NULL || verify->moduleColor == NULL) {
+      dmtxMessageDestroy(&msg);
+      dmtxVerifyDestroy(&verify);
+      return NULL;
+   }
+
+   /* Row 0 is the solid bottom edge, matching the decoder's sampling order */
+   for(symbolRow = 0; symbolRow < verify->symbolRows; symbolRow++) {
+      for(symbolCol = 0; symbolCol < verify->symbolCols; symbolCol++) {
+         verify->module[symbolRow * verify->symbolCols + symbolCol] =
+               (dmtxSymbolModuleStatus(msg, sizeIdx, symbolRow, symbolCol) & DmtxModuleOnRGB) ?
+               DmtxTrue : DmtxFalse;
+      }
+   }
+
+   dmtxMessageDestroy(&msg);
+
+   return verify;
+}
+
+/**
+ * \brief  Free expected module pattern
+ * \param  verify
+ * \return DmtxPass | DmtxFail
+ */
+extern DmtxPassFail
+dmtxVerifyDestroy(DmtxVerify **verify)
+{
+   if(verify == NULL || *verify == NULL)
+      return DmtxFail;
+
+   if((*verify)->module != NULL)
+      free((*verify)->module);
+
+   if((*verify)->moduleColor != NULL)
+      free((*verify)->moduleColor);
+
+   free(*verify);
+
+   *verify = NULL;
+
+   return DmtxPass;
+}
+
+/**
+ * \brief  Compare sampled modules of a region with the expected pattern.
+ *         Each module's margin is its distance from the on/off threshold
+ *         on the expected side, scaled so 1.0 means the full on or off
+ *         color of the region and values at or below 0.0 are mismatches.
+ * \param  dec
+ * \param  reg Region found by dmtxRegionFindNext() or dmtxRegionScanPixel()
+ * \param  verify Expected pattern. Its sampling buffer is reused, so one
+ *         pattern shouldn't be shared by concurrent calls.
+ * \param  result Receives mismatch count and margins
+ * \return DmtxPass | DmtxFail if region size differs from expected symbol
+ */
+extern DmtxPassFail
+dmtxVerifyRegion(DmtxDecode *dec, DmtxRegion *reg, DmtxVerify *verify, DmtxVerifyResult *result)
+{
+   int i, moduleCount;
+   int threshold, halfContrast;
+   double margin, marginSum;
+
+   if(dec == NULL || reg == NULL || verify == NULL || result == NULL)
+      return DmtxFail;
+
+   moduleCount = verify->symbolRows * verify->symbolCols;
+
+   result->moduleCount = moduleCount;
+   result->mismatchCount = moduleCount;
+   result->marginMin = -1.0;
+   result->marginMean = -1.0;
+
+   if(reg->sizeIdx != verify->sizeIdx)
+      return DmtxFail;
+
+   threshold = (reg->onColor + reg->offColor)/2;
+   halfContrast = (reg->onColor - reg->offColor)/2;
+   if(halfContrast == 0)
+      return DmtxFail;
+
+   SampleModuleColors(dec, reg, verify->moduleColor);
+
+   result->mismatchCount = 0;
+   result->marginMin = 1.0;
+   marginSum = 0.0;
+
+   for(i = 0; i < moduleCount; i++) {
+      margin = (verify->moduleColor[i] - threshold)/(double)halfContrast;
+      if(verify->module[i] == DmtxFalse)
+         margin = -margin;
+
+      if(margin <= 0.0)
+         result->mismatchCount++;
+
+      if(margin < result->marginMin)
+         result->marginMin = margin;
+
+      marginSum += margin;
+   }
+
+   result->marginMean = marginSum/moduleCount;
+
+   return DmtxPass;
+}
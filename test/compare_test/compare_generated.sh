@@ -1,7 +1,6 @@
 #!/bin/sh
 
-#SCHEMES="b f a c t x e 8"
-SCHEMES="b a c t x e 8"
+SCHEMES="b f a c t x e 8"
 DMTXWRITE="$(which dmtxwrite)"
 DMTXREAD="$(which dmtxread)"
 MOGRIFY=$(which mogrify)
@@ -0,0 +1,209 @@
+/**
+ * libdmtx - Data Matrix Encoding/Decoding Library
+ * Copyright 2008, 2009 Mike Laughton. All rights reserved.
+ * Copyright 2012-2016 Vadim A. Misbakh-Soloviov. All rights reserved.
+ *
+ * See LICENSE file in the main project directory for full
+ * terms of use and distribution.
+ *
+ * Contact:
+ * Vadim A. Misbakh-Soloviov <dmtx@mva.name>
+ * Mike Laughton <mike@dragonflylogic.com>
+ *
+ * \file encode_test.c
+ * \brief Compare DmtxSchemeAutoFast against DmtxSchemeAutoBest
+ *
+ * Usage: encode_test [-r repeat] message.dat ...
+ *
+ * Each message is encoded with both automatic schemes, read back from its
+ * module pattern, and timed over repeated runs. Codewords used are the
+ * symbol's data words less the padding found on decode. Exits non-zero if
+ * any symbol fails to read back or if AutoFast can't encode a message that
+ * AutoBest can.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../../dmtx.h"
+
+typedef struct {
+   int             sizeIdx;
+   int             wordsUsed;
+   double          seconds;
+   DmtxBoolean     readBack;      /* Symbol decoded to the original message */
+} EncodeResult;
+
+static int ReadMessage(char *path, unsigned char *buf, int capacity);
+static DmtxPassFail EncodeMessage(unsigned char *buf, int length, int scheme, int repeat, EncodeResult *result);
+
+int
+main(int argc, char *argv[])
+{
+   int i, repeat, length, errors;
+   int fastMore, fastLess, fastBigger, messages;
+   long bestWords, fastWords;
+   double bestSeconds, fastSeconds;
+   unsigned char buf[4096];
+   EncodeResult best, fast;
+
+   repeat = 20;
+   i = 1;
+   if(argc > 2 && strcmp(argv[1], "-r") == 0) {
+      repeat = atoi(argv[2]);
+      i = 3;
+   }
+
+   if(i >= argc || repeat < 1) {
+      fprintf(stderr, "Usage: %s [-r repeat] message.dat ...\n", argv[0]);
+      return 2;
+   }
+
+   errors = messages = fastMore = fastLess = fastBigger = 0;
+   bestWords = fastWords = 0;
+   bestSeconds = fastSeconds = 0.0;
+
+   fprintf(stdout, "%-24s %6s %9s %9s %6s\n", "message", "length", "best", "fast", "diff");
+
+   for(; i < argc; i++) {
+      length = ReadMessage(argv[i], buf, sizeof(buf));
+      if(length < 0) {
+         fprintf(stdout, "%-24s unreadable\n", argv[i]);
+         errors++;
+         continue;
+      }
+
+      if(EncodeMessage(buf, length, DmtxSchemeAutoBest, repeat, &best) == DmtxFail) {
+         fprintf(stdout, "%-24s %6d       n/a\n", argv[i], length);
+         continue;
+      }
+
+      if(best.readBack == DmtxFalse) {
+         fprintf(stdout, "%-24s %6d  READBACK\n", argv[i], length);
+         errors++;
+         continue;
+      }
+
+      if(EncodeMessage(buf, length, DmtxSchemeAutoFast, repeat, &fast) == DmtxFail) {
+         fprintf(stdout, "%-24s %6d %9d    FAILED\n", argv[i], length, best.wordsUsed);
+         errors++;
+         continue;
+      }
+
+      if(fast.readBack == DmtxFalse) {
+         fprintf(stdout, "%-24s %6d %9d  READBACK\n", argv[i], length, best.wordsUsed);
+         errors++;
+         continue;
+      }
+
+      fprintf(stdout, "%-24s %6d %9d %9d %+6d%s\n", argv[i], length, best.wordsUsed,
+            fast.wordsUsed, fast.wordsUsed - best.wordsUsed,
+            (fast.sizeIdx != best.sizeIdx) ? " (larger symbol)" : "");
+
+      messages++;
+      bestWords += best.wordsUsed;
+      fastWords += fast.wordsUsed;
+      bestSeconds += best.seconds;
+      fastSeconds += fast.seconds;
+      fastMore += (fast.wordsUsed > best.wordsUsed) ? 1 : 0;
+      fastLess += (fast.wordsUsed < best.wordsUsed) ? 1 : 0;
+      fastBigger += (fast.sizeIdx != best.sizeIdx) ? 1 : 0;
+   }
+
+   fprintf(stdout, "\n%d messages: fast used more codewords in %d, fewer in %d, "
+         "and a larger symbol in %d\n", messages, fastMore, fastLess, fastBigger);
+   fprintf(stdout, "codewords: best %ld, fast %ld (%+.2f%%)\n", bestWords, fastWords,
+         (bestWords > 0) ? 100.0 * (fastWords - bestWords) / bestWords : 0.0);
+   fprintf(stdout, "encode time over %d runs: best %.3fs, fast %.3fs (%.1fx)\n", repeat,
+         bestSeconds, fastSeconds, (fastSeconds > 0.0) ? bestSeconds / fastSeconds : 0.0);
+   fprintf(stdout, "%d error(s) encountered\n", errors);
+
+   return (errors == 0) ? 0 : 1;
+}
+
+/**
+ *
+ *
+ */
+static int
+ReadMessage(char *path, unsigned char *buf, int capacity)
+{
+   int length;
+   FILE *fp;
+
+   fp = fopen(path, "rb");
+   if(fp == NULL)
+      return -1;
+
+   length = (int)fread(buf, 1, capacity, fp);
+   fclose(fp);
+
+   return length;
+}
+
+/**
+ * Encode message repeatedly, then read the last symbol back from its
+ * module pattern to confirm the content and count padding. Returns
+ * DmtxFail only if the message can't be encoded; a symbol that doesn't
+ * read back is reported through result->readBack.
+ */
+static DmtxPassFail
+EncodeMessage(unsigned char *buf, int length, int scheme, int repeat, EncodeResult *result)
+{
+   int i, mappingRows, mappingCols;
+   clock_t start;
+   DmtxEncode *enc;
+   DmtxMessage *msg;
+
+   result->wordsUsed = 0;
+   result->readBack = DmtxFalse;
+
+   enc = dmtxEncodeCreate();
+   if(enc == NULL)
+      return DmtxFail;
+
+   dmtxEncodeSetProp(enc, DmtxPropScheme, scheme);
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, 1);
+   dmtxEncodeSetProp(enc, DmtxPropMarginSize, 0);
+
+   start = clock();
+   for(i = 0; i < repeat; i++) {
+      if(dmtxEncodeDataMatrix(enc, length, buf) == DmtxFail) {
+         dmtxEncodeDestroy(&enc);
+         return DmtxFail;
+      }
+   }
+   result->seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+   result->sizeIdx = enc->region.sizeIdx;
+
+   mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, result->sizeIdx);
+   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, result->sizeIdx);
+
+   msg = dmtxMessageCreate(result->sizeIdx, DmtxFormatMatrix);
+   if(msg == NULL) {
+      dmtxEncodeDestroy(&enc);
+      return DmtxPass;
+   }
+
+   for(i = 0; i < mappingRows * mappingCols; i++)
+      msg->array[i] = (enc->message->array[i] & DmtxModuleOnRGB) | DmtxModuleAssigned;
+
+   dmtxEncodeDestroy(&enc);
+
+   msg = dmtxDecodePopulatedArray(result->sizeIdx, msg, DmtxUndefined);
+   if(msg == NULL)
+      return DmtxPass;
+
+   if(msg->outputIdx != length || memcmp(msg->output, buf, length) != 0) {
+      dmtxMessageDestroy(&msg);
+      return DmtxPass;
+   }
+
+   result->wordsUsed = dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, result->sizeIdx) -
+         msg->padCount;
+   result->readBack = DmtxTrue;
+   dmtxMessageDestroy(&msg);
+
+   return DmtxPass;
+}
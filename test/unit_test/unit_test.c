@@ -29,6 +29,16 @@ static void FatalError(int idx, char* msg)
 
 static void timeAddTest(void);
 static void timePrint(DmtxTime t);
+static void decodeRebindTest(void);
+static void decodeDetectTest(int detectMode);
+static void decodeFindAllTest(void);
+static void verifyRegionTest(void);
+static void decodeErasureTest(DmtxBoolean markUnsure);
+static void decodeTaskRunnerTest(void);
+static void encodeSizeTest(void);
+static void encodePrefixTest(void);
+static void encodeLongRunTest(void);
+static void encodeReuseTest(void);
 
 int
 main(int argc, char *argv[])
@@ -36,6 +46,18 @@ main(int argc, char *argv[])
    programName = argv[0];
 
    timeAddTest();
+   decodeRebindTest();
+   decodeDetectTest(DmtxDetectHough);
+   decodeDetectTest(DmtxDetectRunLength);
+   decodeFindAllTest();
+   verifyRegionTest();
+   decodeErasureTest(DmtxFalse);
+   decodeErasureTest(DmtxTrue);
+   decodeTaskRunnerTest();
+   encodeSizeTest();
+   encodePrefixTest();
+   encodeLongRunTest();
+   encodeReuseTest();
 
    exit(0);
 }
@@ -98,6 +120,337 @@ timeAddTest(void)
    }
 }
 
+/**
+ *
+ *
+ */
+static void
+decodeRebindTest(void)
+{
+   unsigned char pxl[64 * 64];
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxScanGrid grid;
+   DmtxScanConstraint constraint;
+
+   memset(pxl, 0xff, sizeof(pxl));
+   img = dmtxImageCreate(pxl, 64, 64, DmtxPack8bppK);
+   dec = dmtxDecodeCreate(img, 1);
+
+   memset(&constraint, 0x00, sizeof(DmtxScanConstraint));
+   constraint.maxIterations = 10;
+   if(dmtxRegionFindNextDeterministic(dec, &constraint) != NULL ||
+         constraint.stopCause != DmtxScanIterLimit)
+      FatalError(1, "decodeRebindTest\n");
+
+   /* Unchanged scene keeps scan progress */
+   grid = dec->grid;
+   if(dmtxDecodeRebindImage(dec, img, DmtxTrue) != DmtxPass)
+      FatalError(2, "decodeRebindTest\n");
+   if(memcmp(&grid, &(dec->grid), sizeof(DmtxScanGrid)) != 0)
+      FatalError(3, "decodeRebindTest\n");
+
+   /* Changed scene restarts from first location */
+   if(dmtxDecodeRebindImage(dec, img, DmtxFalse) != DmtxPass)
+      FatalError(4, "decodeRebindTest\n");
+   if(dec->grid.pixelCount != 0 || dec->grid.extent != dec->grid.maxExtent)
+      FatalError(5, "decodeRebindTest\n");
+
+   constraint.maxIterations = 0;
+   if(dmtxRegionFindNextDeterministic(dec, &constraint) != NULL ||
+         constraint.stopCause != DmtxScanNotFound ||
+         dmtxDecodeScanComplete(dec) != DmtxTrue)
+      FatalError(6, "decodeRebindTest\n");
+
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+}
+
+/**
+ *
+ *
+ */
+static void
+decodeDetectTest(int detectMode)
+{
+   int x, y, value;
+   unsigned char *pxl;
+   unsigned char str[] = "30Q324343430794<OQQ";
+   DmtxEncode *enc;
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxRegion *reg;
+   DmtxMessage *msg;
+
+   enc = dmtxEncodeCreate();
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, 3);
+   if(dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass)
+      FatalError(1, "decodeDetectTest\n");
+
+   /* Place symbol away from the origin of a larger image */
+   pxl = (unsigned char *)malloc(256 * 256);
+   memset(pxl, 0xff, 256 * 256);
+   img = dmtxImageCreate(pxl, 256, 256, DmtxPack8bppK);
+
+   for(y = 0; y < dmtxImageGetProp(enc->image, DmtxPropHeight); y++) {
+      for(x = 0; x < dmtxImageGetProp(enc->image, DmtxPropWidth); x++) {
+         dmtxImageGetPixelValue(enc->image, x, y, 0, &value);
+         dmtxImageSetPixelValue(img, x + 100, y + 90, 0, value);
+      }
+   }
+
+   dec = dmtxDecodeCreate(img, 1);
+   if(dmtxDecodeSetProp(dec, DmtxPropDetectMode, detectMode) != DmtxPass)
+      FatalError(2, "decodeDetectTest\n");
+
+   reg = dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      FatalError(3, "decodeDetectTest\n");
+
+   msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+   if(msg == NULL || msg->outputIdx != (int)strlen((char *)str) ||
+         memcmp(msg->output, str, msg->outputIdx) != 0)
+      FatalError(4, "decodeDetectTest\n");
+
+   dmtxMessageDestroy(&msg);
+   dmtxRegionDestroy(&reg);
+
+   if(dmtxRegionFindNext(dec, NULL) != NULL || dmtxDecodeScanComplete(dec) != DmtxTrue)
+      FatalError(5, "decodeDetectTest\n");
+
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   dmtxEncodeDestroy(&enc);
+   free(pxl);
+}
+
+/**
+ *
+ *
+ */
+static void
+decodeFindAllTest(void)
+{
+   int i, k, x, y, value;
+   int found[3];
+   unsigned char *pxl;
+   unsigned char *str[] = { (unsigned char *)"FIRST", (unsigned char *)"SECOND 2",
+         (unsigned char *)"THIRD SYMBOL 3" };
+   DmtxEncode *enc;
+   DmtxImage *img;
+   DmtxDecode *dec;
+   DmtxResultList *results;
+   DmtxSymbolResult *symbol;
+
+   pxl = (unsigned char *)malloc(320 * 120);
+   memset(pxl, 0xff, 320 * 120);
+   img = dmtxImageCreate(pxl, 320, 120, DmtxPack8bppK);
+
+   /* Place three symbols side by side */
+   for(k = 0; k < 3; k++) {
+      enc = dmtxEncodeCreate();
+      dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+      if(dmtxEncodeDataMatrix(enc, strlen((char *)str[k]), str[k]) != DmtxPass)
+         FatalError(1, "decodeFindAllTest\n");
+
+      for(y = 0; y < dmtxImageGetProp(enc->image, DmtxPropHeight); y++) {
+         for(x = 0; x < dmtxImageGetProp(enc->image, DmtxPropWidth); x++) {
+            dmtxImageGetPixelValue(enc->image, x, y, 0, &value);
+            dmtxImageSetPixelValue(img, x + 10 + k * 100, y + 10, 0, value);
+         }
+      }
+
+      dmtxEncodeDestroy(&enc);
+   }
+
+   dec = dmtxDecodeCreate(img, 1);
+   results = dmtxDecodeFindAll(dec, NULL, DmtxUndefined, DmtxUndefined);
+   if(results == NULL || results->count != 3 || results->stopCause != DmtxScanNotFound)
+      FatalError(2, "decodeFindAllTest\n");
+
+   memset(found, 0x00, sizeof(found));
+   for(i = 0; i < results->count; i++) {
+      symbol = &(results->symbol[i]);
+      for(k = 0; k < 3; k++) {
+         if(symbol->outputLength == (int)strlen((char *)str[k]) &&
+               memcmp(results->output + symbol->outputIdx, str[k], symbol->outputLength) == 0)
+            found[k]++;
+      }
+   }
+   if(found[0] != 1 || found[1] != 1 || found[2] != 1)
+      FatalError(3, "decodeFindAllTest\n");
+
+   dmtxResultListDestroy(&results);
+   dmtxDecodeDestroy(&dec);
+
+   /* Expected count ends the scan early */
+   dec = dmtxDecodeCreate(img, 1);
+   results = dmtxDecodeFindAll(dec, NULL, 1, DmtxUndefined);
+   if(results == NULL || results->count != 1 || results->stopCause != DmtxScanSuccess)
+      FatalError(4, "decodeFindAllTest\n");
+
+   dmtxResultListDestroy(&results);
+   dmtxDecodeDestroy(&dec);
+   dmtxImageDestroy(&img);
+   free(pxl);
+}
+
+/**
+ *
+ *
+ */
+static void
+verifyRegionTest(void)
+{
+   unsigned char str[] = "30Q324343430794<OQQ";
+   unsigned char other[] = "30Q324343430794<OQX";
+   DmtxEncode *enc;
+   DmtxDecode *dec;
+   DmtxRegion *reg;
+   DmtxVerify *verify;
+   DmtxVerifyResult result;
+
+   enc = dmtxEncodeCreate();
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+   if(dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass)
+      FatalError(1, "verifyRegionTest\n");
+
+   dec = dmtxDecodeCreate(enc->image, 1);
+   reg = dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      FatalError(2, "verifyRegionTest\n");
+
+   /* Printed content matches with room to spare */
+   verify = dmtxVerifyCreate(enc, strlen((char *)str), str);
+   if(verify == NULL || dmtxVerifyRegion(dec, reg, verify, &result) != DmtxPass ||
+         result.moduleCount != reg->symbolRows * reg->symbolCols ||
+         result.mismatchCount != 0 || result.marginMin <= 0.5)
+      FatalError(3, "verifyRegionTest\n");
+   dmtxVerifyDestroy(&verify);
+
+   /* One changed character flips data and error correction modules */
+   verify = dmtxVerifyCreate(enc, strlen((char *)other), other);
+   if(verify == NULL || dmtxVerifyRegion(dec, reg, verify, &result) != DmtxPass ||
+         result.mismatchCount == 0 || result.marginMin >= 0.0)
+      FatalError(4, "verifyRegionTest\n");
+   dmtxVerifyDestroy(&verify);
+
+   dmtxRegionDestroy(&reg);
+   dmtxDecodeDestroy(&dec);
+   dmtxEncodeDestroy(&enc);
+}
+
+/**
+ *
+ *
+ */
+static void
+decodeErasureTest(DmtxBoolean markUnsure)
+{
+   int i, row, col, mappingRows, mappingCols;
+   unsigned char str[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+   DmtxEncode *enc;
+   DmtxMessage *msg;
+
+   enc = dmtxEncodeCreate();
+   if(dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass)
+      FatalError(1, "decodeErasureTest\n");
+
+   mappingRows = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixRows, enc->region.sizeIdx);
+   mappingCols = dmtxGetSymbolAttribute(DmtxSymAttribMappingMatrixCols, enc->region.sizeIdx);
+
+   msg = dmtxMessageCreate(enc->region.sizeIdx, DmtxFormatMatrix);
+   for(i = 0; i < mappingRows * mappingCols; i++)
+      msg->array[i] = (enc->message->array[i] & DmtxModuleOnRGB) | DmtxModuleAssigned;
+
+   /* Invert a patch spanning more codewords than errors alone can repair */
+   for(row = 4; row < 13; row++) {
+      for(col = 4; col < 13; col++) {
+         msg->array[row * mappingCols + col] ^= DmtxModuleOnRGB;
+         if(markUnsure)
+            msg->array[row * mappingCols + col] |= DmtxModuleUnsure;
+      }
+   }
+
+   msg = dmtxDecodePopulatedArray(enc->region.sizeIdx, msg, DmtxUndefined);
+   if(markUnsure) {
+      if(msg == NULL || msg->outputIdx != (int)strlen((char *)str) ||
+            memcmp(msg->output, str, msg->outputIdx) != 0)
+         FatalError(2, "decodeErasureTest\n");
+      dmtxMessageDestroy(&msg);
+   }
+   else if(msg != NULL) {
+      FatalError(3, "decodeErasureTest\n");
+   }
+
+   dmtxEncodeDestroy(&enc);
+}
+
+/**
+ * Runs tasks last to first and records how many were handed over
+ */
+static void
+reverseTaskRunner(void (*task)(void *), void **taskArg, int taskCount, void *context)
+{
+   int i;
+
+   *(int *)context += taskCount;
+
+   for(i = taskCount - 1; i >= 0; i--)
+      (*task)(taskArg[i]);
+}
+
+/**
+ *
+ *
+ */
+static void
+decodeTaskRunnerTest(void)
+{
+   int x, y, width, height, rowSizeBytes, bytesPerPixel;
+   int taskCount = 0;
+   unsigned char str[] = "Interleaved blocks are repaired through the task runner";
+   DmtxEncode *enc;
+   DmtxDecode *dec;
+   DmtxRegion *reg;
+   DmtxMessage *msg;
+
+   enc = dmtxEncodeCreate();
+   dmtxEncodeSetProp(enc, DmtxPropModuleSize, 4);
+   dmtxEncodeSetProp(enc, DmtxPropSizeRequest, DmtxSymbol52x52);
+   if(dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass)
+      FatalError(1, "decodeTaskRunnerTest\n");
+
+   /* Invert a patch in the middle so both blocks carry errors */
+   width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+   height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+   rowSizeBytes = dmtxImageGetProp(enc->image, DmtxPropRowSizeBytes);
+   bytesPerPixel = dmtxImageGetProp(enc->image, DmtxPropBytesPerPixel);
+   for(y = height/2 - 16; y < height/2 + 16; y++) {
+      for(x = (width/2 - 16) * bytesPerPixel; x < (width/2 + 16) * bytesPerPixel; x++)
+         enc->image->pxl[y * rowSizeBytes + x] ^= 0xff;
+   }
+
+   dec = dmtxDecodeCreate(enc->image, 1);
+   dmtxDecodeSetTaskRunner(dec, reverseTaskRunner, &taskCount);
+   reg = dmtxRegionFindNext(dec, NULL);
+   if(reg == NULL)
+      FatalError(2, "decodeTaskRunnerTest\n");
+
+   msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+   if(msg == NULL || msg->outputIdx != (int)strlen((char *)str) ||
+         memcmp(msg->output, str, msg->outputIdx) != 0)
+      FatalError(3, "decodeTaskRunnerTest\n");
+
+   if(taskCount < 2)
+      FatalError(4, "decodeTaskRunnerTest\n");
+
+   dmtxMessageDestroy(&msg);
+   dmtxRegionDestroy(&reg);
+   dmtxDecodeDestroy(&dec);
+   dmtxEncodeDestroy(&enc);
+}
+
 /**
  *
  *
@@ -121,3 +474,164 @@ TestRGB(void)
    dmtxImageCreate(ptr, 320, 240, DmtxPack24bppRGB);
 }
 */
+
+/**
+ *
+ *
+ */
+static void
+encodeSizeTest(void)
+{
+   int i;
+   unsigned char str[] = "30Q324343430794<OQQ";
+   int schemes[] = { DmtxSchemeAutoBest, DmtxSchemeAutoFast, DmtxSchemeAscii, DmtxSchemeC40 };
+   DmtxEncode *enc;
+   DmtxEncodeSize size;
+
+   for(i = 0; i < 4; i++) {
+      enc = dmtxEncodeCreate();
+      dmtxEncodeSetProp(enc, DmtxPropScheme, schemes[i]);
+
+      /* Dry run reports the symbol a full encode would build */
+      if(dmtxEncodeDataMatrixSize(enc, strlen((char *)str), str, &size) != DmtxPass ||
+            dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass)
+         FatalError(1, "encodeSizeTest\n");
+
+      if(size.sizeIdx != enc->region.sizeIdx ||
+            size.remainingCount != enc->message->padCount ||
+            size.dataWordCount + size.remainingCount !=
+            dmtxGetSymbolAttribute(DmtxSymAttribSymbolDataWords, size.sizeIdx))
+         FatalError(2, "encodeSizeTest\n");
+
+      dmtxEncodeDestroy(&enc);
+   }
+}
+
+/**
+ *
+ *
+ */
+static void
+encodePrefixTest(void)
+{
+   int i, serialSize;
+   unsigned char str[64];
+   unsigned char prefixStr[] = "(01)09506000134352(17)201231(10)ABC123(21)";
+   int prefixSize = strlen((char *)prefixStr);
+   char *serials[] = { "", "7", "0042", "A1B2C3D4", "x-99/zz" };
+   DmtxEncode *enc, *ref;
+   DmtxEncodePrefix *prefix;
+
+   enc = dmtxEncodeCreate();
+   dmtxEncodeSetProp(enc, DmtxPropScheme, DmtxSchemeAutoBest);
+
+   prefix = dmtxEncodePrefixCreate(enc, prefixSize, prefixStr);
+   if(prefix == NULL)
+      FatalError(1, "encodePrefixTest\n");
+
+   /* Resumed search builds the same symbol as encoding the whole message */
+   for(i = 0; i < 5; i++) {
+      serialSize = strlen(serials[i]);
+      memcpy(str, prefixStr, prefixSize);
+      memcpy(str + prefixSize, serials[i], serialSize);
+
+      ref = dmtxEncodeCreate();
+      dmtxEncodeSetProp(ref, DmtxPropScheme, DmtxSchemeAutoBest);
+
+      if(dmtxEncodeDataMatrix(ref, prefixSize + serialSize, str) != DmtxPass ||
+            dmtxEncodeDataMatrixPrefixed(enc, prefix, serialSize, (unsigned char *)serials[i]) != DmtxPass)
+         FatalError(2, "encodePrefixTest\n");
+
+      if(ref->region.sizeIdx != enc->region.sizeIdx ||
+            memcmp(ref->message->code, enc->message->code, ref->message->codeSize) != 0)
+         FatalError(3, "encodePrefixTest\n");
+
+      dmtxEncodeDestroy(&ref);
+   }
+
+   dmtxEncodePrefixDestroy(&prefix);
+
+   /* Prefix may be nothing but a leading FNC1 */
+   dmtxEncodeSetProp(enc, DmtxPropFnc1, 232);
+   prefixStr[0] = 232;
+
+   prefix = dmtxEncodePrefixCreate(enc, 1, prefixStr);
+   if(prefix == NULL)
+      FatalError(4, "encodePrefixTest\n");
+
+   memcpy(str, prefixStr, 1);
+   memcpy(str + 1, "0109506000134352", 16);
+
+   ref = dmtxEncodeCreate();
+   dmtxEncodeSetProp(ref, DmtxPropScheme, DmtxSchemeAutoBest);
+   dmtxEncodeSetProp(ref, DmtxPropFnc1, 232);
+
+   if(dmtxEncodeDataMatrix(ref, 17, str) != DmtxPass ||
+         dmtxEncodeDataMatrixPrefixed(enc, prefix, 16, str + 1) != DmtxPass ||
+         ref->region.sizeIdx != enc->region.sizeIdx ||
+         memcmp(ref->message->code, enc->message->code, ref->message->codeSize) != 0)
+      FatalError(5, "encodePrefixTest\n");
+
+   dmtxEncodeDestroy(&ref);
+   dmtxEncodePrefixDestroy(&prefix);
+   dmtxEncodeDestroy(&enc);
+}
+
+/**
+ *
+ *
+ */
+static void
+encodeLongRunTest(void)
+{
+   int i;
+   unsigned char str[3116];
+   DmtxEncode *enc;
+   DmtxEncodeSize size;
+
+   enc = dmtxEncodeCreate();
+   dmtxEncodeSetProp(enc, DmtxPropScheme, DmtxSchemeAutoBest);
+
+   /* Runs past 255 words stay compact all the way through */
+   for(i = 0; i < 300; i++)
+      str[i] = '0' + i % 10;
+   if(dmtxEncodeDataMatrixSize(enc, 300, str, &size) != DmtxPass ||
+         size.dataWordCount != 151)
+      FatalError(1, "encodeLongRunTest\n");
+
+   for(i = 0; i < 700; i++)
+      str[i] = "ABC*>\r12 "[i % 9];
+   if(dmtxEncodeDataMatrixSize(enc, 700, str, &size) != DmtxPass ||
+         size.dataWordCount != 470)
+      FatalError(2, "encodeLongRunTest\n");
+
+   /* Largest digit message still fills 144x144 exactly */
+   for(i = 0; i < 3116; i++)
+      str[i] = '0' + i % 10;
+   if(dmtxEncodeDataMatrixSize(enc, 3116, str, &size) != DmtxPass ||
+         size.sizeIdx != DmtxSymbol144x144 || size.remainingCount != 0)
+      FatalError(3, "encodeLongRunTest\n");
+
+   dmtxEncodeDestroy(&enc);
+}
+
+/**
+ *
+ *
+ */
+static void
+encodeReuseTest(void)
+{
+   unsigned char str[] = "30Q324343430794<OQQ";
+   DmtxEncode *enc;
+
+   /* Mosaic on an encoder that already holds a symbol replaces it */
+   enc = dmtxEncodeCreate();
+   if(dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass ||
+         dmtxEncodeDataMatrix(enc, strlen((char *)str), str) != DmtxPass ||
+         dmtxEncodeDataMosaic(enc, strlen((char *)str), str) != DmtxPass ||
+         enc->image == NULL || enc->message == NULL)
+      FatalError(1, "encodeReuseTest\n");
+
+   dmtxEncodeDestroy(&enc);
+}